@@ -1,376 +1,710 @@
 #include "hmicx.h"
+#include "hmiclog.h"
+#include "hmicblend.h"
+#include "hmicbenc.h"
+#include "hmicmetrics.h"
+#include "hmictrace.h"
 #include <lz4.h>
 #include <lz4hc.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <map>
 #include <cstring>
 #include <algorithm>
 #include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <exception>
 
 using namespace std;
 using namespace HMICX;
 
-struct RGBA { uint8_t r,g,b,a; };
-
-// Helper functions to write little-endian values
-static void writeU8(ofstream& out, uint8_t val) {
-    out.write((char*)&val, 1);
-}
-
-static void writeU16(ofstream& out, uint16_t val) {
-    uint8_t bytes[2] = {
-        (uint8_t)(val & 0xFF),
-        (uint8_t)((val >> 8) & 0xFF)
-    };
-    out.write((char*)bytes, 2);
-}
-
-static void writeU32(ofstream& out, uint32_t val) {
-    uint8_t bytes[4] = {
-        (uint8_t)(val & 0xFF),
-        (uint8_t)((val >> 8) & 0xFF),
-        (uint8_t)((val >> 16) & 0xFF),
-        (uint8_t)((val >> 24) & 0xFF)
-    };
-    out.write((char*)bytes, 4);
-}
-
-struct FrameIndexEntry {
-    uint32_t offset;
-    uint32_t size;
-    uint8_t  type;
+// What one conversion makes and how. The interactive prompts and the batch command line
+// both fill this in
+struct ConvertOptions {
+    bool createHMICB = true, createHMICB7 = true;
+    CompressOptions pack;
+    BlendMode blend = BlendMode::Classic;
+    EncodeOptions encode;
+    unsigned threads = 0;    // parser and renderer threads, 0 = every core
+    bool alone = true;       // false = other conversions run in the process at the same time
+    bool verbose = true;     // the property/compression/success boxes
+    string metricsPath;      // append a JSON line per conversion here ("-" = stdout, "" = don't)
 };
 
-static RGBA parseColor(const string& s) {
-    RGBA c{255,255,255,255};
-    string str = s;
-    transform(str.begin(), str.end(), str.begin(), ::tolower);
-    if (str.rfind("#",0)==0 && str.size()==7) {
-        c.r = stoi(str.substr(1,2),nullptr,16);
-        c.g = stoi(str.substr(3,2),nullptr,16);
-        c.b = stoi(str.substr(5,2),nullptr,16);
-    } else if (str.find("rgba(")==0) {
-        int r,g,b,a;
-        if (sscanf(str.c_str(),"rgba(%d,%d,%d,%d)",&r,&g,&b,&a)==4)
-            c={uint8_t(r),uint8_t(g),uint8_t(b),uint8_t(a)};
-    } else if (str.find("rgb(")==0) {
-        int r,g,b;
-        if (sscanf(str.c_str(),"rgb(%d,%d,%d)",&r,&g,&b)==3)
-            c={uint8_t(r),uint8_t(g),uint8_t(b),255};
-    }
-    return c;
-}
-
-static vector<vector<RGBA>> renderAllFrames(
-        const vector<Command>& commands,int width,int height,int totalFrames) {
-    cout<<"[DEBUG] 🎨 Rendering "<<totalFrames<<" frames ("<<width<<"x"<<height<<")...\n";
-    cout<<"[DEBUG] 🎨 Processing "<<commands.size()<<" commands...\n";
-    
-    vector<vector<RGBA>> frames(totalFrames, vector<RGBA>(width*height,{0,0,0,0}));
-    
-    int pixelsDrawn = 0;
-    int commandsProcessed = 0;
-    int pixelsSkippedOutOfBounds = 0;
-    int pixelsSkippedWrongFrame = 0;
-    
-    for (size_t cmdIdx = 0; cmdIdx < commands.size(); cmdIdx++) {
-        const auto& cmd = commands[cmdIdx];
-        RGBA color=parseColor(cmd.color);
+// 📈 Stage costs go into `metrics` as they're done, so a failed conversion still shows
+// how far it got
+static vector<string> convert(const string& input, const ConvertOptions& options,
+                              ConversionMetrics& metrics) {
+    // A single-threaded conversion (batch jobs) is measured on its own thread, so the
+    // other jobs' CPU and allocations don't end up in its numbers
+    auto usage = [&] { return options.threads == 1 ? threadUsage() : processUsage(); };
+    
+    bool compressed = (input.size()>=6 &&
+        input.substr(input.size()-6)==".hmic7");
+    // .hmic7 is unpacked into memory and parsed right there - no temp file, so any
+    // number of conversions can run in the same directory
+    string unpacked;
+    
+    if(compressed){
+        HMICX_DEBUG("[DEBUG] 📦 Decompressing HMIC7 with LZ4...\n");
+        Usage t0 = usage();
+        ifstream in(input,ios::binary|ios::ate);
+        if(!in) throw runtime_error("no input");
+        
+        streamsize sz=in.tellg(); 
+        in.seekg(0);
+        if(sz < (streamsize)sizeof(uint64_t)) throw runtime_error("HMIC7 file is too short!!");
         
-        int cmdStart = cmd.start;
-        int cmdEnd = cmd.end;
+        // Read original size (first 8 bytes)
+        uint64_t originalSize;
+        in.read((char*)&originalSize, sizeof(uint64_t));
         
-        if (cmdIdx < 3) {
-            cout<<"[DEBUG] 🔍 Command "<<cmdIdx<<": color="<<cmd.color
-                <<" (parsed as r="<<(int)color.r<<",g="<<(int)color.g<<",b="<<(int)color.b<<",a="<<(int)color.a<<")"
-                <<", frames="<<cmdStart<<"-"<<cmdEnd
-                <<", pixels="<<cmd.pixels.size()<<"\n";
+        // Read compressed data
+        size_t compressedSize = sz - sizeof(uint64_t);
+        if(originalSize > (uint64_t)INT32_MAX || compressedSize > (size_t)INT32_MAX) {
+            throw runtime_error("HMIC7 file is too big for one LZ4 block!!");
         }
+        vector<char> compressedBuf(compressedSize);
+        in.read(compressedBuf.data(), compressedSize);
+        in.close();
+        StageMetrics& read = metrics.add("read", usage() - t0);
+        read.bytesIn = read.bytesOut = (uint64_t)sz;
         
-        for (int f=cmdStart; f<=cmdEnd && f<=totalFrames; ++f) {
-            int idx = f - 1;
-            
-            if(idx < 0 || idx >= totalFrames) {
-                pixelsSkippedWrongFrame += cmd.pixels.size();
-                if (cmdIdx < 3) {
-                    cout<<"[DEBUG]   ⚠️ Frame "<<f<<" (idx="<<idx<<") out of range [0,"<<(totalFrames-1)<<"]!!\n";
-                }
-                continue;
-            }
-            
-            if (cmdIdx < 3) {
-                cout<<"[DEBUG]   ✅ Processing frame "<<f<<" (idx="<<idx<<")\n";
-            }
-            
-            for (const auto& px:cmd.pixels) {
-                int x=px.x-1, y=px.y-1;
-                
-                if (x<0||x>=width||y<0||y>=height) {
-                    pixelsSkippedOutOfBounds++;
-                    if (cmdIdx < 3) {
-                        cout<<"[DEBUG]     ⚠️ Pixel ("<<px.x<<","<<px.y<<") -> ("<<x<<","<<y<<") out of bounds!!\n";
-                    }
-                    continue;
-                }
-                
-                int i=y*width+x;
-                
-                if (color.a==255) {
-                    frames[idx][i]=color;
-                    pixelsDrawn++;
-                } else if (color.a>0) {
-                    RGBA& bg=frames[idx][i];
-                    float a=color.a/255.f, ia=1.f-a;
-                    bg.r=uint8_t(color.r*a+bg.r*ia);
-                    bg.g=uint8_t(color.g*a+bg.g*ia);
-                    bg.b=uint8_t(color.b*a+bg.b*ia);
-                    bg.a=max(bg.a,color.a);
-                    pixelsDrawn++;
-                }
-            }
-            commandsProcessed++;
+        // Decompress!!
+        t0 = usage();
+        unpacked.resize(originalSize);
+        Trace::Span unpackSpan("lz4 decompress", "read");
+        int decompSize = LZ4_decompress_safe(
+            compressedBuf.data(),
+            unpacked.data(),
+            compressedSize,
+            (int)originalSize
+        );
+        unpackSpan.arg("bytes_in", (int64_t)compressedSize);
+        unpackSpan.arg("bytes_out", decompSize);
+        
+        if(decompSize < 0) {
+            throw runtime_error("LZ4 decompression failed!! RIP!! 💀");
         }
+        unpacked.resize(decompSize);
+        StageMetrics& unpack = metrics.add("decompress", usage() - t0);
+        unpack.bytesIn = compressedSize;
+        unpack.bytesOut = (uint64_t)decompSize;
+        
+        HMICX_DEBUG("[DEBUG] ✅ Decompressed "<<compressedSize<<" → "<<decompSize<<" bytes\n");
+    }
+
+    HMICX_DEBUG("[DEBUG] 📖 Parsing HMIC file...\n");
+    // The buffer parser borrows `unpacked`, which lives until the end of this block
+    Usage t0 = usage();
+    Parser p = [&] {
+        if(compressed) return Parser::fromBuffer(unpacked);
+        return Parser::mapFile(input);
+    }();
+    uint64_t textSize = unpacked.size();
+    if(!compressed) {
+        // Mapping the file is all the reading a .hmic gets
+        error_code ec;
+        textSize = filesystem::file_size(input, ec);
+        StageMetrics& read = metrics.add("read", usage() - t0);
+        read.bytesIn = read.bytesOut = textSize;
+        t0 = usage();
+    }
+    {
+        Trace::Span parseSpan("parse", "parse");
+        p.parseArena(options.threads);   // 0 = one worker per core, PL= lines stay runs, pooled storage
     }
+    Usage parseCost = usage() - t0;
     
-    cout<<"[DEBUG] 🎨 Drew "<<pixelsDrawn<<" pixels total\n";
-    cout<<"[DEBUG] 🎨 Commands processed: "<<commandsProcessed<<"\n";
-    cout<<"[DEBUG] 🎨 Pixels skipped (out of bounds): "<<pixelsSkippedOutOfBounds<<"\n";
-    cout<<"[DEBUG] 🎨 Pixels skipped (wrong frame): "<<pixelsSkippedWrongFrame<<"\n";
+    auto h=p.getHeader(); 
+    const CommandArena& arena=p.getArena();
+    const vector<ArenaCommand>& cmds=arena.commands;
+    const Palette& palette=p.getPalette();
     
-    int nonBlackInFrame0 = 0;
-    for (const auto& pixel : frames[0]) {
-        if (pixel.r > 0 || pixel.g > 0 || pixel.b > 0 || pixel.a > 0) {
-            nonBlackInFrame0++;
-        }
-    }
-    cout<<"[DEBUG] 🎨 Non-black pixels in frame 0: "<<nonBlackInFrame0<<" / "<<frames[0].size()<<"\n";
+    HMICX_DEBUG("\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
+                <<"🔍 PARSER OUTPUT ANALYSIS\n"
+                <<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
+    
+    HMICX_DEBUG("[DEBUG] Total commands from parser: "<<cmds.size()<<"\n");
     
-    cout<<"[DEBUG] 🎨 Sample pixels from frame 0:\n";
-    for (int i = 0; i < min(10, (int)frames[0].size()); i++) {
-        auto& p = frames[0][i];
-        if (p.r > 0 || p.g > 0 || p.b > 0 || p.a > 0) {
-            cout<<"[DEBUG]   Pixel "<<i<<": r="<<(int)p.r<<" g="<<(int)p.g<<" b="<<(int)p.b<<" a="<<(int)p.a<<"\n";
+    int emptyCount = 0;
+    int totalPixels = 0;
+    for (size_t i = 0; i < cmds.size(); i++) {
+        size_t n = arena.pixelCount(cmds[i]);
+        if (n == 0) {
+            emptyCount++;
+        } else {
+            totalPixels += n;
+        }
+        
+        if (i < 5) {
+            HMICX_DEBUG("[DEBUG] Command "<<i<<": color="<<palette.name(cmds[i].colorIndex)
+                <<", pixels="<<n
+                <<", frames="<<cmds[i].start<<"-"<<cmds[i].end<<"\n");
         }
     }
     
-    if (pixelsDrawn == 0) {
-        cout<<"[WARNING] ⚠️⚠️⚠️ NO PIXELS DRAWN!! Output will be BLACK!!\n";
-    } else if (nonBlackInFrame0 == 0) {
-        cout<<"[WARNING] ⚠️⚠️⚠️ PIXELS WERE DRAWN BUT FRAME 0 IS ALL BLACK!!\n";
+    HMICX_DEBUG("[DEBUG] Commands with pixels: "<<(cmds.size() - emptyCount)<<"\n");
+    HMICX_DEBUG("[DEBUG] Commands WITHOUT pixels: "<<emptyCount<<"\n");
+    HMICX_DEBUG("[DEBUG] Total pixels across all commands: "<<totalPixels<<"\n");
+    StageMetrics& parse = metrics.add("parse", parseCost);
+    parse.bytesIn = textSize;
+    parse.pixels = (uint64_t)totalPixels;
+    HMICX_DEBUG("[DEBUG] 🎨 Distinct colors: "<<palette.size()<<"\n");
+    
+    if (emptyCount > 0) {
+        cout<<"[WARNING] ⚠️⚠️⚠️ Found "<<emptyCount<<" commands with 0 pixels!!\n";
     }
     
-    return frames;
-}
-
-static void computeDelta(
-        const vector<RGBA>& prev,const vector<RGBA>& curr,int width,
-        vector<uint8_t>& deltaData) {
-    
-    size_t changeCount = 0;
-    for (size_t i=0;i<curr.size();++i) {
-        if (memcmp(&prev[i],&curr[i],sizeof(RGBA))!=0) {
-            changeCount++;
-        }
+    // Empty commands draw nothing, so the renderer can just walk over them - no copy
+    size_t validCount = cmds.size() - emptyCount;
+    HMICX_DEBUG("[DEBUG] ✂️ "<<validCount<<" of "<<cmds.size()<<" commands have pixels\n");
+    
+    if (validCount == 0) {
+        throw runtime_error("💀 NO VALID COMMANDS WITH PIXELS!! Check your HMIC parser!! 💀");
     }
     
-    deltaData.resize(4 + changeCount * 8);
+    HMICX_DEBUG("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n");
     
-    deltaData[0] = (changeCount & 0xFF);
-    deltaData[1] = ((changeCount >> 8) & 0xFF);
-    deltaData[2] = ((changeCount >> 16) & 0xFF);
-    deltaData[3] = ((changeCount >> 24) & 0xFF);
+    int width=5, height=5, fps=2, frames=1; 
+    bool loop=true;
     
-    size_t offset = 4;
-    for (size_t i=0;i<curr.size();++i) {
-        if (memcmp(&prev[i],&curr[i],sizeof(RGBA))!=0) {
-            uint16_t x = i % width;
-            uint16_t y = i / width;
-            
-            deltaData[offset++] = x & 0xFF;
-            deltaData[offset++] = (x >> 8) & 0xFF;
-            deltaData[offset++] = y & 0xFF;
-            deltaData[offset++] = (y >> 8) & 0xFF;
-            deltaData[offset++] = curr[i].r;
-            deltaData[offset++] = curr[i].g;
-            deltaData[offset++] = curr[i].b;
-            deltaData[offset++] = curr[i].a;
+    for(auto& [k,v]:h){
+        string key=k; 
+        transform(key.begin(),key.end(),key.begin(),::toupper);
+        if(key=="DISPLAY") {
+            if(sscanf(v.c_str(),"%dx%d",&width,&height) != 2) {
+                if(sscanf(v.c_str(),"%dX%d",&width,&height) != 2) {
+                    cout<<"[WARNING] Failed to parse DISPLAY: "<<v<<"\n";
+                } else {
+                    HMICX_DEBUG("[DEBUG] Parsed DISPLAY with uppercase X: "<<width<<"x"<<height<<"\n");
+                }
+            } else {
+                HMICX_DEBUG("[DEBUG] Parsed DISPLAY: "<<width<<"x"<<height<<"\n");
+            }
         }
+        else if(key=="FPS") fps=stoi(v);
+        else if(key=="F") frames=stoi(v);
+        else if(key=="LOOP") loop=(v=="Y"||v=="y"||v=="1");
     }
-}
 
-static void writeHMICB(const string& path, int width, int height, int fps, 
-                       int totalFrames, bool loop,
-                       const vector<vector<RGBA>>& frames) {
-    cout<<"[DEBUG] 💾 Writing "<<path<<"...\n";
-    ofstream out(path,ios::binary);
-    if(!out) throw runtime_error("cannot open output");
+    if(options.verbose) {
+        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        cout<<"📊 ANIMATION PROPERTIES\n";
+        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        cout<<"  Size: "<<width<<"x"<<height<<"\n";
+        cout<<"  FPS: "<<fps<<"\n";
+        cout<<"  Frames: "<<frames<<"\n";
+        cout<<"  Loop: "<<(loop?"yes":"no")<<"\n";
+        cout<<"  Commands: "<<validCount<<"\n";
+        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    }
 
-    out.write("HMICB", 5);
-    writeU8(out, 1);
-    writeU16(out, (uint16_t)width);
-    writeU16(out, (uint16_t)height);
-    writeU16(out, (uint16_t)fps);
-    writeU32(out, (uint32_t)totalFrames);
-    writeU8(out, loop ? 1 : 0);
-    writeU8(out, 1);
-    
-    for(int i = 0; i < 14; i++) {
-        writeU8(out, 0);
+    if(width <= 0 || height <= 0 || width > 10000 || height > 10000) {
+        throw runtime_error("Invalid dimensions!");
     }
-    
-    streampos afterHeader = out.tellp();
-    cout<<"[DEBUG] After header: byte "<<afterHeader<<" (should be 32)\n";
+    metrics.width = width;
+    metrics.height = height;
+    metrics.frames = frames;
 
-    uint32_t indexSize = frames.size() * 9;
-    uint32_t dataStartOffset = 32 + indexSize;
+    LayeredRenderer renderer(arena,palette,width,height,frames,options.blend,options.threads);   // 0 = every core
+    // Render ahead while the writer encodes - pointless with a single core
+    unsigned cores = options.threads ? options.threads : thread::hardware_concurrency();
+    FramePipeline fr(renderer, cores > 1 ? 2 : 0);
+    
+    string base=input.substr(0,input.find_last_of('.'));
+    string hmicbFile = base + ".hmicb";
+    string hmicb7File = base + ".hmicb7";
+    
+    // Render, delta and write interleave (on two threads when pipelined), so they're
+    // measured where each one runs and added up per frame
+    auto recordEncode = [&](const WriteStats& ws, const Usage& extraWrite, uint64_t hmicbSize) {
+        uint64_t framePixels = (uint64_t)width * height * (uint64_t)max(frames, 0);
+        StageMetrics& render = metrics.add("render", renderer.cost());
+        render.bytesOut = framePixels * sizeof(RGBA);
+        render.pixels = renderer.paintedPixels();
+        StageMetrics& delta = metrics.add("delta", ws.delta);
+        delta.bytesIn = ws.pixelsCompared * 2 * sizeof(RGBA);   // previous + current frame
+        delta.bytesOut = ws.deltaBytes;
+        delta.pixels = ws.pixelsCompared;
+        Usage writeCost = ws.write;
+        writeCost += extraWrite;
+        StageMetrics& write = metrics.add("write", writeCost);
+        write.bytesIn = ws.rawBytes;
+        write.bytesOut = hmicbSize;
+        write.pixels = framePixels;
+    };
     
-    cout<<"[DEBUG] Index size: "<<indexSize<<" bytes\n";
-    cout<<"[DEBUG] Frame data will start at byte: "<<dataStartOffset<<"\n";
-
-    streampos indexPos = out.tellp();
-    for (size_t i = 0; i < frames.size(); i++) {
-        writeU32(out, 0);
-        writeU32(out, 0);
-        writeU8(out, 0);
+    if(options.createHMICB7) {
+        // Encode into memory and compress straight from there
+        MemorySink sink;
+        ostream mem(&sink);
+        HMICX_DEBUG("[DEBUG] 💾 Encoding HMICB in memory...\n");
+        WriteStats ws = writeHMICB(mem, width, height, fps, frames, loop, [&](int i) { return fr.render(i); }, options.encode);
+        fr.finish();
+        
+        Usage t0 = usage();
+        if(options.createHMICB) {
+            HMICX_DEBUG("[DEBUG] 💾 Writing "<<hmicbFile<<"...\n");
+            ofstream out(hmicbFile, ios::binary);
+            if(!out) throw runtime_error("cannot open output");
+            out.write(sink.bytes().data(), sink.bytes().size());
+            out.close();
+            if(!out) throw runtime_error("failed writing HMICB output");
+        }
+        recordEncode(ws, usage() - t0, sink.bytes().size());
+        
+        // If they want HMICB7, compress it with LZ4!!
+        if(options.verbose) {
+            cout<<"\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+            cout<<"⚡ LZ4 COMPRESSION (HC MODE) ⚡\n";
+            cout<<"   SPEEDRUN STRATS ACTIVATED!! 🏃💨\n";
+            cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        }
+        t0 = usage();
+        ofstream out7(hmicb7File, ios::binary);
+        if(!out7) throw runtime_error("cannot create HMICB7 output file");
+        size_t packedSize = compressToHMICB7(sink.bytes(), out7, options.pack);
+        out7.close();
+        if(!out7) throw runtime_error("failed writing HMICB7 output file");
+        StageMetrics& pack = metrics.add("compress", usage() - t0);
+        pack.bytesIn = sink.bytes().size();
+        pack.bytesOut = packedSize;
+        if(options.verbose) cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    } else {
+        HMICX_DEBUG("[DEBUG] 💾 Writing "<<hmicbFile<<"...\n");
+        ofstream out(hmicbFile, ios::binary);
+        if(!out) throw runtime_error("cannot open output");
+        WriteStats ws = writeHMICB(out, width, height, fps, frames, loop, [&](int i) { return fr.render(i); }, options.encode);
+        uint64_t hmicbSize = (uint64_t)out.tellp();
+        Usage t0 = usage();
+        out.close();
+        if(!out) throw runtime_error("failed writing HMICB output");
+        Usage closing = usage() - t0;
+        fr.finish();
+        recordEncode(ws, closing, hmicbSize);
     }
     
-    streampos dataStart = out.tellp();
-    cout<<"[DEBUG] Data actually starts at byte "<<dataStart<<" (should be "<<dataStartOffset<<")\n";
     
-    if((uint32_t)dataStart != dataStartOffset) {
-        throw runtime_error("MATH ERROR!! Data start position mismatch!!");
+    vector<string> created;
+    if(options.createHMICB) created.push_back(hmicbFile);
+    if(options.createHMICB7) created.push_back(hmicb7File);
+    
+    if(options.verbose) {
+        cout<<"\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        cout<<"✅ SUCCESS!! Created:\n";
+        if(options.createHMICB) cout<<"   📄 "<<hmicbFile<<" (uncompressed)\n";
+        if(options.createHMICB7) cout<<"   ⚡ "<<hmicb7File<<" (LZ4 HC compressed)\n";
+        cout<<"🔥 LZ4 GO BRRRRR WE COOKIN FR FR!! 🚀\n";
+        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
     }
+    return created;
+}
 
-    vector<FrameIndexEntry> index(frames.size());
-    size_t totalOrig=0, totalOut=0;
-
-    for(size_t i=0;i<frames.size();++i){
-        streampos pos = out.tellp();
-        index[i].offset = (uint32_t)pos;
-        
-        const auto& frame = frames[i];
-        size_t frameSize = frame.size() * sizeof(RGBA);
-        totalOrig += frameSize;
+// .hmic or .hmic7 → .hmicb and/or .hmicb7 next to it. Returns the files it wrote,
+// throws runtime_error when anything goes wrong. With options.metricsPath set, a JSON
+// line with every stage's cost is appended there - also when the conversion fails
+static vector<string> convertFile(const string& input, const ConvertOptions& options) {
+    Trace::Span span("convert", "file");
+    span.detail(input);
+    ConversionMetrics metrics;
+    metrics.input = input;
+    metrics.ownsProcess = options.alone;
+    Usage started = options.threads == 1 ? threadUsage() : processUsage();
+    vector<string> created;
+    exception_ptr failure;
+    try {
+        created = convert(input, options, metrics);
+    } catch (const exception& e) {
+        metrics.error = e.what();
+        failure = current_exception();
+    }
+    if (!options.metricsPath.empty()) {
+        metrics.total = (options.threads == 1 ? threadUsage() : processUsage()) - started;
+        appendMetrics(options.metricsPath, metrics.toJson());
+    }
+    if (failure) rethrow_exception(failure);
+    return created;
+}
 
-        if(i == 0 || i % 10 == 0){
-            out.write((char*)frame.data(), frameSize);
-            index[i].size = (uint32_t)frameSize;
-            index[i].type = 0;
-            totalOut += frameSize;
-            
-            if(i == 0) {
-                cout<<"[DEBUG] Frame 0 written at byte "<<pos
-                    <<", size="<<frameSize<<" bytes (full frame)\n";
+// 🧵 WORK-STEALING FILE POOL 🧵
+// Every worker has its own deque of jobs. Jobs are sorted biggest first and dealt out
+// round robin; a worker takes from the front of its own deque (its biggest left) and,
+// once that's empty, steals from the back of someone else's (their smallest). Big files
+// start right away and small ones fill the gaps at the end, so nobody sits idle while
+// one worker is stuck with a pile of leftovers.
+// fn(job) runs on up to `workers` threads (the caller is one of them). The first
+// exception stops handing out work and is rethrown here
+template <class Fn>
+static void runStealing(const vector<uintmax_t>& sizes, unsigned workers, Fn fn) {
+    workers = max(1u, min<unsigned>(workers, (unsigned)sizes.size()));
+    vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+    
+    vector<deque<size_t>> queues(workers);
+    vector<mutex> locks(workers);
+    for (size_t i = 0; i < order.size(); i++) queues[i % workers].push_back(order[i]);
+    
+    atomic<bool> failed{false};
+    exception_ptr failure;
+    mutex failureMutex;
+    
+    auto next = [&](unsigned self, size_t& job) {
+        {
+            lock_guard<mutex> lock(locks[self]);
+            if (!queues[self].empty()) {
+                job = queues[self].front();
+                queues[self].pop_front();
+                return true;
             }
-        } else {
-            vector<uint8_t> deltaData;
-            computeDelta(frames[i-1], frame, width, deltaData);
-            
-            out.write((char*)deltaData.data(), deltaData.size());
-            index[i].size = (uint32_t)deltaData.size();
-            index[i].type = 1;
-            totalOut += deltaData.size();
-            
-            if(i == 1) {
-                cout<<"[DEBUG] Frame 1 written at byte "<<pos
-                    <<", size="<<deltaData.size()<<" bytes (delta frame)\n";
+        }
+        for (unsigned k = 1; k < workers; k++) {
+            unsigned victim = (self + k) % workers;
+            lock_guard<mutex> lock(locks[victim]);
+            if (!queues[victim].empty()) {
+                job = queues[victim].back();
+                queues[victim].pop_back();
+                return true;
             }
         }
-
-        if(i < 3 || i == frames.size() - 1) {
-            cout<<"[DEBUG] Frame "<<i
-                <<": offset="<<index[i].offset
-                <<", size="<<index[i].size
-                <<", type="<<(int)index[i].type<<"\n";
+        return false;   // nothing gets added later, so empty everywhere = done
+    };
+    auto work = [&](unsigned self) {
+        size_t job;
+        while (!failed && next(self, job)) {
+            try {
+                fn(job);
+            } catch (...) {
+                lock_guard<mutex> lock(failureMutex);
+                if (!failure) failure = current_exception();
+                failed = true;
+            }
         }
+    };
+    
+    vector<thread> pool;
+    for (unsigned t = 1; t < workers; t++) {
+        pool.emplace_back([&work, t] {
+            Trace::nameThread("job worker " + to_string(t));
+            work(t);
+        });
     }
+    work(0);
+    for (auto& th : pool) th.join();
+    if (failure) rethrow_exception(failure);
+}
 
-    out.seekp(indexPos);
-    cout<<"[DEBUG] Backpatching index at byte "<<indexPos<<"...\n";
-    
-    for (size_t i = 0; i < index.size(); i++) {
-        writeU32(out, index[i].offset);
-        writeU32(out, index[i].size);
-        writeU8(out, index[i].type);
+// '*' = any run of characters, '?' = any one character. On a mismatch only the last '*'
+// needs to take one more character - the earlier ones can't do better - so no backtracking
+static bool wildcardMatch(const char* pattern, const char* name) {
+    const char* star = nullptr;   // last '*' seen
+    const char* retry = nullptr;  // where the name resumes when that '*' takes one more
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            retry = name;
+        } else if (*pattern == '?' || *pattern == *name) {
+            pattern++;
+            name++;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++retry;
+        } else {
+            return false;
+        }
     }
-    
-    cout<<"[DEBUG] Index backpatched!!\n";
-    cout<<"[DEBUG] First frame index entry: offset="<<index[0].offset
-        <<", size="<<index[0].size
-        <<", type="<<(int)index[0].type<<"\n";
-    
-    out.close();
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
 
-    cout<<"[DEBUG] Delta compression: "<<totalOrig<<" → "<<totalOut
-        <<" bytes ("<<(totalOrig > 0 ? 100.0*(1.0-totalOut/(double)totalOrig) : 0)<<"% saved)\n";
+// A path, or a glob in its file name part ("anims/*.hmic7"). Expanded here and not just
+// by the shell, since cmd.exe hands the pattern over as is. Sorted, so runs are repeatable
+static vector<string> expandInput(const string& arg) {
+    size_t slash = arg.find_last_of("/\\");
+    string dir = (slash == string::npos) ? "" : arg.substr(0, slash + 1);
+    string pattern = arg.substr(dir.size());
+    if (pattern.find_first_of("*?") == string::npos) return {arg};
+    
+    vector<string> matches;
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator(dir.empty() ? "." : dir, ec)) {
+        string name = entry.path().filename().string();
+        if (entry.is_regular_file(ec) && wildcardMatch(pattern.c_str(), name.c_str())) {
+            matches.push_back(dir + name);
+        }
+    }
+    sort(matches.begin(), matches.end());
+    return matches;
 }
 
-// 🔥🔥 LZ4 COMPRESSION GO BRRRRR!! 🚀🚀
-static void compressToHMICB7(const string& hmicbPath, const string& hmicb7Path) {
-    cout<<"\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-    cout<<"⚡ LZ4 COMPRESSION (HC MODE) ⚡\n";
-    cout<<"   SPEEDRUN STRATS ACTIVATED!! 🏃💨\n";
-    cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-    
-    // Read the uncompressed HMICB file
-    ifstream in(hmicbPath, ios::binary | ios::ate);
-    if(!in) throw runtime_error("cannot open HMICB file for compression");
-    
-    streamsize fileSize = in.tellg();
-    in.seekg(0);
+// 🏷️ TAGGED LOG LINES 🏷️
+// Batch mode puts this under cout, so every [DEBUG] / [SUMMARY] / [WARNING] line says
+// which file it's about: "[anims/a.hmic] [SUMMARY] stage=parse ...". Each thread builds
+// its line on its own and hands it over whole, so lines of conversions running side by
+// side never mix. Threads with no tag of their own (render-ahead, parse workers) use the
+// fallback, which is only set while a single file converts at a time
+class TaggedLines : public streambuf {
+public:
+    explicit TaggedLines(streambuf* out_) : out(out_) {}
+    
+    // What the calling thread's lines start with from now on, "" = nothing
+    void tagThread(const string& tag) {
+        flushLine();
+        threadTag() = tag;
+        threadTagged() = true;
+    }
+    void setFallback(const string& tag) {
+        lock_guard<mutex> lock(outMutex);
+        fallback = tag;
+    }
     
-    vector<char> uncompressedData(fileSize);
-    in.read(uncompressedData.data(), fileSize);
-    in.close();
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+        char ch = traits_type::to_char_type(c);
+        xsputn(&ch, 1);
+        return c;
+    }
     
-    cout<<"[DEBUG] 📖 Read "<<fileSize<<" bytes from "<<hmicbPath<<"\n";
+    streamsize xsputn(const char* s, streamsize n) override {
+        string& line = pending();
+        for (streamsize i = 0; i < n; i++) {
+            line += s[i];
+            if (s[i] == '\n') flushLine();
+        }
+        return n;
+    }
     
-    // Get max compressed size bound (LZ4 needs this for buffer allocation)
-    int maxCompressedSize = LZ4_compressBound(fileSize);
-    vector<char> compressedData(maxCompressedSize);
+    int sync() override {
+        flushLine();
+        lock_guard<mutex> lock(outMutex);
+        return out->pubsync();
+    }
     
-    cout<<"[DEBUG] 🔨 Compressing with LZ4 HC (high compression mode)... LETS GOOOO!!\n";
+private:
+    streambuf* out;
+    mutex outMutex;
+    string fallback;
+    
+    static string& pending() { thread_local string line; return line; }
+    static string& threadTag() { thread_local string tag; return tag; }
+    static bool& threadTagged() { thread_local bool tagged = false; return tagged; }
+    
+    void flushLine() {
+        string& line = pending();
+        if (line.empty()) return;
+        lock_guard<mutex> lock(outMutex);
+        const string& tag = threadTagged() ? threadTag() : fallback;
+        if (!tag.empty()) {
+            out->sputc('[');
+            out->sputn(tag.data(), (streamsize)tag.size());
+            out->sputn("] ", 2);
+        }
+        out->sputn(line.data(), (streamsize)line.size());
+        line.clear();
+    }
+};
+
+static void printUsage() {
+    cout<<"usage: hmicb [options] <file.hmic|file.hmic7|glob>...\n"
+          "       hmicb                      (no arguments: ask for everything, one file)\n"
+          "\n"
+          "  -f, --format hmicb|hmicb7|both   what to write next to each input [both]\n"
+          "  -l, --level N                    LZ4 HC level 1-12 [12]\n"
+          "      --layout block|chunked|linked  HMICB7 layout [block]\n"
+          "  -j, --jobs N                     files converted at once, 0 = every core [0]\n"
+          "      --blend classic|over         blend mode [classic]\n"
+          "      --deltas pixel|runs          delta frame format [pixel]\n"
+          "      --keyframes fixed|adaptive   every 10th frame, or adaptive [fixed]\n"
+          "      --keyframe-distance N        max frames between adaptive keyframes [60]\n"
+          "      --delta-limit X              adaptive: keyframe when a delta is over X of a full frame [0.5]\n"
+          "      --metrics FILE               append a JSON line of stage metrics per file (- = stdout)\n"
+          "      --trace FILE                 write a Chrome/Perfetto timeline of the whole run\n"
+          "  -h, --help                       this text\n";
+}
+
+static int numberArg(const string& option, const string& value) {
+    try {
+        size_t used = 0;
+        int n = stoi(value, &used);
+        if (used == value.size()) return n;
+    } catch (const exception&) {}
+    throw runtime_error(option + " needs a number, got '" + value + "'");
+}
+
+// A share of a full frame, > 0 (a bit over 1 is allowed: run deltas can be bigger than raw)
+static double shareArg(const string& option, const string& value) {
+    try {
+        size_t used = 0;
+        double v = stod(value, &used);
+        if (used == value.size() && v > 0 && v <= 4) return v;
+    } catch (const exception&) {}
+    throw runtime_error(option + " needs a number above 0 and up to 4, got '" + value + "'");
+}
+
+// 📦 BATCH MODE 📦
+// hmicb [options] inputs... - no prompts, every input converted with the same options,
+// several at once. With more than one job each conversion stays on one thread, so the
+// cores go to files instead of fighting over them
+static int runBatch(int argc, char** argv) {
+    ConvertOptions options;
+    options.verbose = false;
+    unsigned jobs = 0;
+    vector<string> patterns;
+    string tracePath;
+    
+    try {
+        bool optionsDone = false;
+        for (int i = 1; i < argc; i++) {
+            string a = argv[i];
+            auto value = [&]() -> string {
+                if (i + 1 >= argc) throw runtime_error(a + " needs a value");
+                return argv[++i];
+            };
+            auto choice = [&](const string& v, initializer_list<const char*> names) {
+                int k = 1;
+                for (const char* n : names) {
+                    if (v == n || v == to_string(k)) return k;
+                    k++;
+                }
+                throw runtime_error("unknown value '" + v + "' for " + a);
+            };
+            
+            if (optionsDone || a.empty() || a[0] != '-') { patterns.push_back(a); continue; }
+            if (a == "--") optionsDone = true;
+            else if (a == "-h" || a == "--help") { printUsage(); return 0; }
+            else if (a == "-f" || a == "--format") {
+                int f = choice(value(), {"hmicb", "hmicb7", "both"});
+                options.createHMICB = (f == 1 || f == 3);
+                options.createHMICB7 = (f == 2 || f == 3);
+            }
+            else if (a == "-l" || a == "--level") {
+                options.pack.level = min(max(numberArg(a, value()), 1), (int)LZ4HC_CLEVEL_MAX);
+            }
+            else if (a == "--layout") {
+                int l = choice(value(), {"block", "chunked", "linked"});
+                options.pack.chunked = (l >= 2);
+                options.pack.linked = (l == 3);
+            }
+            else if (a == "-j" || a == "--jobs") jobs = (unsigned)max(numberArg(a, value()), 0);
+            else if (a.rfind("-j", 0) == 0) jobs = (unsigned)max(numberArg("-j", a.substr(2)), 0);
+            else if (a == "--blend") {
+                options.blend = choice(value(), {"classic", "over"}) == 2 ? BlendMode::Over : BlendMode::Classic;
+            }
+            else if (a == "--deltas") options.encode.runDeltas = choice(value(), {"pixel", "runs"}) == 2;
+            else if (a == "--keyframes") options.encode.adaptiveKeyframes = choice(value(), {"fixed", "adaptive"}) == 2;
+            else if (a == "--keyframe-distance") {
+                options.encode.adaptiveKeyframes = true;
+                options.encode.maxKeyframeDistance = max(1, numberArg(a, value()));
+            }
+            else if (a == "--delta-limit") {
+                options.encode.adaptiveKeyframes = true;
+                options.encode.deltaLimit = shareArg(a, value());
+            }
+            else if (a == "--metrics") options.metricsPath = value();
+            else if (a == "--trace") tracePath = value();
+            else throw runtime_error("unknown option " + a + " (try --help)");
+        }
+    } catch (const exception& e) {
+        cerr<<"❌ ERROR: "<<e.what()<<"\n";
+        return 2;
+    }
     
-    // Use LZ4_compress_HC for better compression (level 9 = max compression)
-    // If you want SPEED instead of compression, use LZ4_compress_default()
-    int compressedSize = LZ4_compress_HC(
-        uncompressedData.data(),
-        compressedData.data(),
-        fileSize,
-        maxCompressedSize,
-        LZ4HC_CLEVEL_MAX  // 🔥 MAX COMPRESSION LEVEL!! (level 12)
-    );
+    vector<string> inputs;
+    for (const string& p : patterns) {
+        vector<string> found = expandInput(p);
+        if (found.empty()) cerr<<"[WARNING] ⚠️ Nothing matches "<<p<<"\n";
+        for (string& f : found) {
+            if (find(inputs.begin(), inputs.end(), f) == inputs.end()) inputs.push_back(std::move(f));
+        }
+    }
+    if (inputs.empty()) {
+        cerr<<"❌ ERROR: no input files (try --help)\n";
+        return 2;
+    }
     
-    if(compressedSize <= 0) {
-        throw runtime_error("LZ4 compression failed!! Yikes!! 💀");
+    vector<uintmax_t> sizes(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        error_code ec;
+        sizes[i] = filesystem::file_size(inputs[i], ec);
+        if (ec) sizes[i] = 0;   // convertFile reports it properly
     }
     
-    // Write compressed data to .hmicb7
-    ofstream out(hmicb7Path, ios::binary);
-    if(!out) throw runtime_error("cannot create HMICB7 output file");
+    if (jobs == 0) jobs = max(1u, thread::hardware_concurrency());
+    jobs = min<unsigned>(jobs, (unsigned)inputs.size());
+    options.threads = jobs > 1 ? 1 : 0;
+    options.alone = (jobs == 1);
+    options.pack.threads = options.threads;
     
-    // Store original size first (8 bytes for decompression)
-    uint64_t origSize = fileSize;
-    out.write((char*)&origSize, sizeof(uint64_t));
+    // From here on lines may come from several threads at once
+    streambuf* console = cout.rdbuf();
+    TaggedLines tagged(console);
+    cout.rdbuf(&tagged);
     
-    // Write compressed data
-    out.write(compressedData.data(), compressedSize);
-    out.close();
+    cout<<"🎤 Converting "<<inputs.size()<<" file"<<(inputs.size() == 1 ? "" : "s")
+        <<" with "<<jobs<<" job"<<(jobs == 1 ? "" : "s")<<"\n";
     
-    size_t totalWritten = compressedSize + sizeof(uint64_t);
-    double ratio = 100.0 * (1.0 - (double)totalWritten / (double)fileSize);
+    if (!tracePath.empty()) {
+        Trace::start();
+        Trace::nameThread("main");
+    }
     
-    cout<<"[DEBUG] 💾 Wrote "<<totalWritten<<" bytes to "<<hmicb7Path<<"\n";
-    cout<<"[DEBUG]    (original size header: 8 bytes, compressed data: "<<compressedSize<<" bytes)\n";
-    cout<<"[DEBUG] 📊 Compression ratio: "<<fileSize<<" → "<<totalWritten
-        <<" bytes ("<<ratio<<"% smaller)\n";
-    cout<<"[DEBUG] ⚡ LZ4 was probably WAY faster than ZSTD btw!! No cap!! 🚀\n";
+    mutex printMutex;
+    size_t done = 0, failures = 0;
+    auto started = chrono::steady_clock::now();
+    runStealing(sizes, jobs, [&](size_t job) {
+        auto t0 = chrono::steady_clock::now();
+        string error;
+        vector<string> created;
+        tagged.tagThread(inputs[job]);
+        if (jobs == 1) tagged.setFallback(inputs[job]);
+        try {
+            created = convertFile(inputs[job], options);
+        } catch (const exception& e) {
+            error = e.what();
+        }
+        tagged.tagThread("");
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        
+        lock_guard<mutex> lock(printMutex);
+        done++;
+        if (!error.empty()) {
+            failures++;
+            cerr<<"❌ ["<<done<<"/"<<inputs.size()<<"] "<<inputs[job]<<": "<<error<<"\n";
+            return;
+        }
+        cout<<"✅ ["<<done<<"/"<<inputs.size()<<"] "<<inputs[job]<<" →";
+        for (size_t k = 0; k < created.size(); k++) cout<<(k ? ", " : " ")<<created[k];
+        cout<<" ("<<round(seconds * 100) / 100<<" s)\n";
+    });
+    
+    double total = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    bool traced = true;
+    if (!tracePath.empty()) {
+        try {
+            Trace::stop(tracePath);
+        } catch (const exception& e) {
+            cerr<<"❌ ERROR: "<<e.what()<<"\n";
+            traced = false;
+        }
+    }
     cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    cout<<(inputs.size() - failures)<<" converted, "<<failures<<" failed in "<<round(total * 100) / 100<<" s\n";
+    cout.flush();
+    cout.rdbuf(console);
+    return (failures || !traced) ? 1 : 0;
 }
 
-int main(){
+int main(int argc, char** argv){
+    if(argc > 1) return runBatch(argc, argv);
+    
     cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
     cout<<"🎤 HMIC → HMICB/HMICB7 CONVERTER v6.0 🎤\n";
     cout<<"   NOW WITH LZ4 COMPRESSION!! ⚡⚡⚡\n";
@@ -393,174 +727,103 @@ int main(){
         createHMICB = createHMICB7 = true;
     }
     
-    try{
-        bool compressed = (input.size()>=6 &&
-            input.substr(input.size()-6)==".hmic7");
-        string parsePath=input;
-        string temp=".tmp.hmic";
-        
-        if(compressed){
-            cout<<"[DEBUG] 📦 Decompressing HMIC7 with LZ4...\n";
-            ifstream in(input,ios::binary|ios::ate);
-            if(!in) throw runtime_error("no input");
-            
-            streamsize sz=in.tellg(); 
-            in.seekg(0);
-            
-            // Read original size (first 8 bytes)
-            uint64_t originalSize;
-            in.read((char*)&originalSize, sizeof(uint64_t));
-            
-            // Read compressed data
-            size_t compressedSize = sz - sizeof(uint64_t);
-            vector<char> compressedBuf(compressedSize);
-            in.read(compressedBuf.data(), compressedSize);
-            in.close();
-            
-            // Decompress!!
-            vector<char> outBuf(originalSize);
-            int decompSize = LZ4_decompress_safe(
-                compressedBuf.data(),
-                outBuf.data(),
-                compressedSize,
-                originalSize
-            );
-            
-            if(decompSize < 0) {
-                throw runtime_error("LZ4 decompression failed!! RIP!! 💀");
-            }
-            
-            cout<<"[DEBUG] ✅ Decompressed "<<compressedSize<<" → "<<decompSize<<" bytes\n";
-            
-            ofstream t(temp,ios::binary);
-            t.write(outBuf.data(),decompSize); 
-            t.close();
-            parsePath=temp;
-        }
-
-        cout<<"[DEBUG] 📖 Parsing HMIC file...\n";
-        Parser p(parsePath); 
-        p.parse();
-        
-        auto h=p.getHeader(); 
-        auto cmds=p.getCommands();
-        
-        cout<<"\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        cout<<"🔍 PARSER OUTPUT ANALYSIS\n";
-        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        
-        cout<<"[DEBUG] Total commands from parser: "<<cmds.size()<<"\n";
+    CompressOptions pack;
+    if(createHMICB7) {
+        string layout;
+        cout<<"🧱 HMICB7 layout (1=one block, 2=chunk per keyframe group for seeking, "
+              "3=chunked + linked for a better ratio; 2 and 3 need a new viewer) [1]: ";
+        getline(cin, layout);
+        pack.chunked = (layout == "2" || layout == "3");
+        pack.linked = (layout == "3");
         
-        int emptyCount = 0;
-        int totalPixels = 0;
-        for (size_t i = 0; i < cmds.size(); i++) {
-            if (cmds[i].pixels.empty()) {
-                emptyCount++;
-            } else {
-                totalPixels += cmds[i].pixels.size();
-            }
-            
-            if (i < 5) {
-                cout<<"[DEBUG] Command "<<i<<": color="<<cmds[i].color
-                    <<", pixels="<<cmds[i].pixels.size()
-                    <<", frames="<<cmds[i].start<<"-"<<cmds[i].end<<"\n";
-            }
-        }
-        
-        cout<<"[DEBUG] Commands with pixels: "<<(cmds.size() - emptyCount)<<"\n";
-        cout<<"[DEBUG] Commands WITHOUT pixels: "<<emptyCount<<"\n";
-        cout<<"[DEBUG] Total pixels across all commands: "<<totalPixels<<"\n";
-        
-        if (emptyCount > 0) {
-            cout<<"[WARNING] ⚠️⚠️⚠️ Found "<<emptyCount<<" commands with 0 pixels!!\n";
+        string level;
+        cout<<"⚙️ LZ4 HC level (1-12) ["<<pack.level<<"]: ";
+        getline(cin, level);
+        if (!level.empty()) {
+            try { pack.level = min(max(stoi(level), 1), (int)LZ4HC_CLEVEL_MAX); }
+            catch (const exception&) { cout<<"⚠️ Not a number, keeping "<<pack.level<<"\n"; }
         }
         
-        vector<Command> validCmds;
-        for (const auto& cmd : cmds) {
-            if (!cmd.pixels.empty()) {
-                validCmds.push_back(cmd);
+        if (pack.chunked) {
+            string threads;
+            cout<<"🧵 Compression threads (0=every core) [0]: ";
+            getline(cin, threads);
+            if (!threads.empty()) {
+                try { pack.threads = (unsigned)max(stoi(threads), 0); }
+                catch (const exception&) { cout<<"⚠️ Not a number, using every core\n"; }
             }
         }
-        
-        cout<<"[DEBUG] ✂️ Filtered "<<cmds.size()<<" → "<<validCmds.size()<<" valid commands\n";
-        
-        if (validCmds.empty()) {
-            throw runtime_error("💀 NO VALID COMMANDS WITH PIXELS!! Check your HMIC parser!! 💀");
-        }
-        
-        cmds = validCmds;
-        
-        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
-        
-        int width=5, height=5, fps=2, frames=1; 
-        bool loop=true;
-        
-        for(auto& [k,v]:h){
-            string key=k; 
-            transform(key.begin(),key.end(),key.begin(),::toupper);
-            if(key=="DISPLAY") {
-                if(sscanf(v.c_str(),"%dx%d",&width,&height) != 2) {
-                    if(sscanf(v.c_str(),"%dX%d",&width,&height) != 2) {
-                        cout<<"[WARNING] Failed to parse DISPLAY: "<<v<<"\n";
-                    } else {
-                        cout<<"[DEBUG] Parsed DISPLAY with uppercase X: "<<width<<"x"<<height<<"\n";
-                    }
-                } else {
-                    cout<<"[DEBUG] Parsed DISPLAY: "<<width<<"x"<<height<<"\n";
-                }
-            }
-            else if(key=="FPS") fps=stoi(v);
-            else if(key=="F") frames=stoi(v);
-            else if(key=="LOOP") loop=(v=="Y"||v=="y"||v=="1");
-        }
-
-        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        cout<<"📊 ANIMATION PROPERTIES\n";
-        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        cout<<"  Size: "<<width<<"x"<<height<<"\n";
-        cout<<"  FPS: "<<fps<<"\n";
-        cout<<"  Frames: "<<frames<<"\n";
-        cout<<"  Loop: "<<(loop?"yes":"no")<<"\n";
-        cout<<"  Commands: "<<cmds.size()<<"\n";
-        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
-
-        if(width <= 0 || height <= 0 || width > 10000 || height > 10000) {
-            throw runtime_error("Invalid dimensions!");
+    }
+    
+    // Classic keeps old files byte-identical, over is the mathematically right one
+    string blendChoice;
+    cout<<"🎨 Blend mode (1=classic, 2=exact over) [1]: ";
+    getline(cin, blendChoice);
+    BlendMode blend = (blendChoice == "2") ? BlendMode::Over : BlendMode::Classic;
+    
+    string deltaChoice;
+    cout<<"🧩 Delta frames (1=per pixel, 2=compact runs, needs a new viewer) [1]: ";
+    getline(cin, deltaChoice);
+    EncodeOptions encode;
+    encode.runDeltas = (deltaChoice == "2");
+    
+    string keyChoice;
+    cout<<"🔑 Keyframes (1=every 10th frame, 2=adaptive) [1]: ";
+    getline(cin, keyChoice);
+    if (keyChoice == "2") {
+        encode.adaptiveKeyframes = true;
+        string distance;
+        cout<<"🔑 Max frames between keyframes ["<<encode.maxKeyframeDistance<<"]: ";
+        getline(cin, distance);
+        if (!distance.empty()) {
+            try { encode.maxKeyframeDistance = max(1, stoi(distance)); }
+            catch (const exception&) { cout<<"⚠️ Not a number, keeping "<<encode.maxKeyframeDistance<<"\n"; }
         }
-
-        auto fr=renderAllFrames(cmds,width,height,frames);
-        
-        string base=input.substr(0,input.find_last_of('.'));
-        string hmicbFile = base + ".hmicb";
-        string hmicb7File = base + ".hmicb7";
-        
-        // Always create HMICB first (we need it for compression)
-        writeHMICB(hmicbFile, width, height, fps, frames, loop, fr);
-        
-        // If they want HMICB7, compress it with LZ4!!
-        if(createHMICB7) {
-            compressToHMICB7(hmicbFile, hmicb7File);
+        string limit;
+        cout<<"🔑 Keyframe when a delta is over this much of a full frame (1 = smallest file) ["
+            <<encode.deltaLimit<<"]: ";
+        getline(cin, limit);
+        if (!limit.empty()) {
+            try { encode.deltaLimit = shareArg("delta limit", limit); }
+            catch (const exception& e) { cout<<"⚠️ "<<e.what()<<", keeping "<<encode.deltaLimit<<"\n"; }
         }
-        
-        // If they ONLY wanted HMICB7, delete the uncompressed version
-        if(createHMICB7 && !createHMICB) {
-            cout<<"[DEBUG] 🗑️  Removing intermediate HMICB file (keeping only HMICB7)...\n";
-            remove(hmicbFile.c_str());
+    }
+    
+    string metricsPath;
+    cout<<"📈 Append stage metrics as JSON to (empty = no metrics) []: ";
+    getline(cin, metricsPath);
+    
+    string tracePath;
+    cout<<"🧵 Write a Chrome trace of the run to (empty = no trace) []: ";
+    getline(cin, tracePath);
+    
+    ConvertOptions options;
+    options.metricsPath = metricsPath;
+    options.createHMICB = createHMICB;
+    options.createHMICB7 = createHMICB7;
+    options.pack = pack;
+    options.blend = blend;
+    options.encode = encode;
+    
+    if(!tracePath.empty()) {
+        Trace::start();
+        Trace::nameThread("main");
+    }
+    
+    try{
+        convertFile(input, options);
+        if(!tracePath.empty()) {
+            Trace::stop(tracePath);
+            cout<<"🧵 Trace written to "<<tracePath<<" (open it in ui.perfetto.dev or chrome://tracing)\n";
         }
-        
-        if(compressed) remove(temp.c_str());
-        
-        cout<<"\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        cout<<"✅ SUCCESS!! Created:\n";
-        if(createHMICB) cout<<"   📄 "<<hmicbFile<<" (uncompressed)\n";
-        if(createHMICB7) cout<<"   ⚡ "<<hmicb7File<<" (LZ4 HC compressed)\n";
-        cout<<"🔥 LZ4 GO BRRRRR WE COOKIN FR FR!! 🚀\n";
-        cout<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        
     }catch(const exception& e){ 
         cerr<<"\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
         cerr<<"❌ ERROR: "<<e.what()<<"\n"; 
         cerr<<"━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        // A trace of a failed run is still worth having
+        if(Trace::enabled()) {
+            try { Trace::stop(tracePath); } catch (const exception&) {}
+        }
         return 1; 
     }
     
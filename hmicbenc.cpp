@@ -0,0 +1,862 @@
+#include "hmicbenc.h"
+#include "hmiclog.h"
+#include "hmicdelta.h"
+#include "hmictrace.h"
+#include <lz4.h>
+#include <lz4hc.h>
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace HMICX;
+
+// Helper functions to write little-endian values
+static void writeU8(ostream& out, uint8_t val) {
+    out.write((char*)&val, 1);
+}
+
+static void writeU16(ostream& out, uint16_t val) {
+    uint8_t bytes[2] = {
+        (uint8_t)(val & 0xFF),
+        (uint8_t)((val >> 8) & 0xFF)
+    };
+    out.write((char*)bytes, 2);
+}
+
+static void writeU32(ostream& out, uint32_t val) {
+    uint8_t bytes[4] = {
+        (uint8_t)(val & 0xFF),
+        (uint8_t)((val >> 8) & 0xFF),
+        (uint8_t)((val >> 16) & 0xFF),
+        (uint8_t)((val >> 24) & 0xFF)
+    };
+    out.write((char*)bytes, 4);
+}
+
+static void writeU64(ostream& out, uint64_t val) {
+    writeU32(out, (uint32_t)(val & 0xFFFFFFFFu));
+    writeU32(out, (uint32_t)(val >> 32));
+}
+
+static uint32_t readU32(const char* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+struct FrameIndexEntry {
+    uint32_t offset;
+    uint32_t size;
+    uint8_t  type;
+};
+
+// 🧵 Run fn(0..count-1) on up to `threads` threads (the caller is one of them).
+// The first exception stops handing out work and is rethrown here
+template <class Fn>
+static void parallelFor(size_t count, unsigned threads, Fn fn) {
+    atomic<size_t> next{0};
+    exception_ptr failure;
+    mutex failureMutex;
+    
+    auto worker = [&]() {
+        try {
+            for (size_t i = next++; i < count; i = next++) fn(i);
+        } catch (...) {
+            lock_guard<mutex> lock(failureMutex);
+            if (!failure) failure = current_exception();
+            next = count;
+        }
+    };
+    
+    unsigned workers = (unsigned)min<size_t>(max(1u, threads), count);
+    vector<thread> pool;
+    for (unsigned t = 1; t < workers; t++) {
+        pool.emplace_back([&] {
+            Trace::nameThread("worker");
+            worker();
+        });
+    }
+    worker();
+    for (auto& t : pool) t.join();
+    if (failure) rethrow_exception(failure);
+}
+
+BandPool::BandPool(unsigned threads) {
+    for (unsigned t = 1; t < threads; t++) helpers.emplace_back(&BandPool::help, this, t);
+}
+
+void BandPool::stop() {
+    {
+        lock_guard<mutex> lock(jobMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : helpers) t.join();
+    helpers.clear();
+}
+
+void BandPool::drain() {
+    for (size_t i = next++; i < jobSize; i = next++) {
+        try {
+            (*job)(i);
+        } catch (...) {
+            lock_guard<mutex> lock(jobMutex);
+            if (!failure) failure = current_exception();
+            next = jobSize;
+        }
+    }
+}
+
+void BandPool::help(unsigned index) {
+    // One lane per helper for the whole animation, not one per frame
+    Trace::nameThread("band helper " + to_string(index));
+    uint64_t seen = 0;
+    unique_lock<mutex> lock(jobMutex);
+    for (;;) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (--busy == 0) done.notify_all();
+    }
+}
+
+void BandPool::run(size_t count, const function<void(size_t)>& fn) {
+    {
+        lock_guard<mutex> lock(jobMutex);
+        job = &fn;
+        jobSize = count;
+        next = 0;
+        failure = nullptr;
+        busy = helpers.size();
+        generation++;
+    }
+    wake.notify_all();
+    drain();
+    unique_lock<mutex> lock(jobMutex);
+    done.wait(lock, [&] { return busy == 0; });
+    job = nullptr;
+    if (failure) rethrow_exception(failure);
+}
+
+// Horizontal slice of a frame one worker paints: rows [y0, y1). Out-of-bounds pixels
+// belong to no band, the first band counts them so totals match a single pass
+struct Band {
+    int y0, y1;
+    bool first;
+    BlendMode blend;
+};
+
+// Paint `count` pixels starting at dst, `step` RGBAs apart (see hmicblend.h)
+static void paintRun(RGBA* dst, size_t count, size_t step, RGBA color, Band band, RenderStats& stats) {
+    if (color.a==0) return;
+    blendSpan(dst, count, step, color, band.blend);
+    stats.pixelsDrawn += (int)count;
+}
+
+static void drawPixels(vector<RGBA>& frame, const Pixel* pixels, size_t count, RGBA color,
+                       int width, int height, Band band, RenderStats& stats, bool verbose) {
+    for (const Pixel* px = pixels; px != pixels + count; ++px) {
+        int x=px->x-1, y=px->y-1;
+        
+        if (x<0||x>=width||y<0||y>=height) {
+            if (!band.first) continue;
+            stats.pixelsSkippedOutOfBounds++;
+            if (verbose) {
+                HMICX_DEBUG("[DEBUG]     ⚠️ Pixel ("<<px->x<<","<<px->y<<") -> ("<<x<<","<<y<<") out of bounds!!\n");
+            }
+            continue;
+        }
+        if (y<band.y0||y>=band.y1) continue;
+        
+        paintRun(&frame[y*width+x], 1, 1, color, band, stats);
+    }
+}
+
+// Clip a run along one axis: [from, from+length) against [0, limit) with the fixed
+// coordinate `other` against [0, otherLimit). Returns how many pixels survive
+static size_t clipRun(long long& from, long long length, long long limit,
+                      long long other, long long otherLimit) {
+    if (other<0 || other>=otherLimit) return 0;
+    long long lo=max(from, 0LL), hi=min(from+length, limit);
+    if (hi<=lo) return 0;
+    from=lo;
+    return (size_t)(hi-lo);
+}
+
+// 📏 Each row run goes to the blend kernel in one piece, columns as a strided span
+static void drawCommand(vector<RGBA>& frame, const CommandArena& arena, const ArenaCommand& cmd,
+                        RGBA color, int width, int height, Band band, RenderStats& stats, bool verbose) {
+    drawPixels(frame, arena.pointsOf(cmd), cmd.pointsCount, color, width, height, band, stats, verbose);
+    
+    for (const Run* it = arena.rowsOf(cmd); it != arena.rowsOf(cmd) + cmd.rowsCount; ++it) {
+        const Run& run = *it;
+        long long x=(long long)run.x-1, y=(long long)run.y-1;
+        bool mine = (y>=band.y0 && y<band.y1) || ((y<0 || y>=height) && band.first);
+        if (!mine) continue;
+        size_t n=clipRun(x, run.length, width, y, height);
+        stats.pixelsSkippedOutOfBounds += run.length-(int)n;
+        if (verbose && n<(size_t)run.length) {
+            HMICX_DEBUG("[DEBUG]     ⚠️ Row ("<<run.x<<","<<run.y<<") x"<<run.length<<": "
+                <<(run.length-(int)n)<<" pixels out of bounds!!\n");
+        }
+        if (n) paintRun(&frame[y*width+x], n, 1, color, band, stats);
+    }
+    
+    for (const Run* it = arena.columnsOf(cmd); it != arena.columnsOf(cmd) + cmd.columnsCount; ++it) {
+        const Run& run = *it;
+        long long x=(long long)run.x-1, y=(long long)run.y-1;
+        size_t n=clipRun(y, run.length, height, x, width);
+        if (band.first) {
+            stats.pixelsSkippedOutOfBounds += run.length-(int)n;
+            if (verbose && n<(size_t)run.length) {
+                HMICX_DEBUG("[DEBUG]     ⚠️ Column ("<<run.x<<","<<run.y<<") x"<<run.length<<": "
+                    <<(run.length-(int)n)<<" pixels out of bounds!!\n");
+            }
+        }
+        // Then just the part inside this band
+        long long lo=max(y, (long long)band.y0), hi=min(y+(long long)n, (long long)band.y1);
+        if (hi>lo) paintRun(&frame[lo*width+x], (size_t)(hi-lo), (size_t)width, color, band, stats);
+    }
+}
+
+// Snapshots kept on the stack besides the clear frame. Nested ranges (F1-200, F1-199, ...)
+// would otherwise keep a full frame per level; past this, frames repaint from the nearest one
+static const size_t MAX_SNAPSHOTS = 8;
+
+LayeredRenderer::LayeredRenderer(const CommandArena& arena_, const Palette& palette_, int width_, int height_,
+                                 int totalFrames_, BlendMode blend_, unsigned threads_)
+    : arena(arena_), palette(palette_), width(width_), height(height_),
+      totalFrames(max(totalFrames_, 0)), blend(blend_),
+      threads(threads_ ? threads_ : max(1u, thread::hardware_concurrency())), bandPool(threads) {
+    const vector<ArenaCommand>& commands = arena.commands;
+    HMICX_DEBUG("[DEBUG] 🎨 Rendering "<<totalFrames<<" frames ("<<width<<"x"<<height<<")"
+                <<(blend == BlendMode::Over ? " with exact over blending" : "")<<"...\n");
+    HMICX_DEBUG("[DEBUG] 🎨 Processing "<<commands.size()<<" commands...\n");
+    
+    // 1️⃣ Plan: which commands land on which frame, in painter's order
+    frameCommands.resize(totalFrames);
+    for (size_t cmdIdx = 0; cmdIdx < commands.size(); cmdIdx++) {
+        const auto& cmd = commands[cmdIdx];
+        
+        int cmdStart = cmd.start;
+        int cmdEnd = cmd.end;
+        
+        if (cmdIdx < 3) {
+            RGBA color=palette[cmd.colorIndex];
+            HMICX_DEBUG("[DEBUG] 🔍 Command "<<cmdIdx<<": color="<<palette.name(cmd.colorIndex)
+                <<" (parsed as r="<<(int)color.r<<",g="<<(int)color.g<<",b="<<(int)color.b<<",a="<<(int)color.a<<")"
+                <<", frames="<<cmdStart<<"-"<<cmdEnd
+                <<", pixels="<<arena.pixelCount(cmd)<<"\n");
+        }
+        
+        for (int f=cmdStart; f<=cmdEnd && f<=totalFrames; ++f) {
+            int idx = f - 1;
+            
+            if(idx < 0 || idx >= totalFrames) {
+                pixelsSkippedWrongFrame += arena.pixelCount(cmd);
+                if (cmdIdx < 3) {
+                    HMICX_DEBUG("[DEBUG]   ⚠️ Frame "<<f<<" (idx="<<idx<<") out of range [0,"<<(totalFrames-1)<<"]!!\n");
+                }
+                continue;
+            }
+            
+            if (cmdIdx < 3) {
+                HMICX_DEBUG("[DEBUG]   ✅ Processing frame "<<f<<" (idx="<<idx<<")\n");
+            }
+            
+            frameCommands[idx].push_back((uint32_t)cmdIdx);
+            commandsProcessed++;
+        }
+    }
+    
+    // 2️⃣ How far each frame agrees with the next one
+    sharedWithNext.assign(totalFrames, 0);
+    for (int f = 0; f + 1 < totalFrames; f++) {
+        const auto& a = frameCommands[f];
+        const auto& b = frameCommands[f + 1];
+        sharedWithNext[f] = mismatch(a.begin(), a.begin() + min(a.size(), b.size()), b.begin()).first - a.begin();
+    }
+    
+    stack.push_back({0, make_shared<Frame>((size_t)width*height, RGBA{0,0,0,0}), {}});
+}
+
+void LayeredRenderer::paint(Frame& frame, const vector<uint32_t>& cmds, size_t from, size_t to, RenderStats& st) {
+    const vector<ArenaCommand>& commands = arena.commands;
+    int bands = (threads > 1) ? max(1, min(height, (int)threads * 2)) : 1;
+    int bandHeight = (height + bands - 1) / bands;
+    vector<RenderStats> bandStats(bands);
+    vector<Usage> helperCost(bands);
+    bool verbose = (threads == 1);   // per-pixel chatter only when it can't interleave
+    thread::id caller = this_thread::get_id();
+    
+    bandPool.run((size_t)bands, [&](size_t b) {
+        // Bands on the caller's thread are already in render()'s reading
+        bool helper = this_thread::get_id() != caller;
+        Usage t0 = helper ? threadUsage() : Usage{};
+        Band band{(int)b*bandHeight, min(height, ((int)b+1)*bandHeight), b == 0, blend};
+        for (size_t k = from; k < to; k++) {
+            const auto& cmd = commands[cmds[k]];
+            drawCommand(frame, arena, cmd, palette[cmd.colorIndex], width, height,
+                        band, bandStats[b], verbose && cmds[k] < 3);
+        }
+        if (helper) helperCost[b] = threadUsage() - t0;
+    });
+    
+    // Their CPU and allocations count, their wall time overlaps the caller's
+    for (Usage& u : helperCost) {
+        u.wall = 0;
+        renderCost += u;
+    }
+    for (const auto& bs : bandStats) {
+        st.pixelsDrawn += bs.pixelsDrawn;
+        st.pixelsSkippedOutOfBounds += bs.pixelsSkippedOutOfBounds;
+        pixelsPainted += bs.pixelsDrawn;
+    }
+}
+
+FramePtr LayeredRenderer::render(int idx) {
+    Trace::Span span("render frame", "render");
+    span.arg("frame", idx);
+    Usage t0 = threadUsage();
+    FramePtr frame = renderFrame(idx);
+    renderCost += threadUsage() - t0;
+    return frame;
+}
+
+FramePtr LayeredRenderer::renderFrame(int idx) {
+    if (idx != nextFrame || idx >= totalFrames) {
+        throw runtime_error("LayeredRenderer: frames must be rendered in order");
+    }
+    const vector<uint32_t>& cmds = frameCommands[idx];
+    
+    // Drop snapshots deeper than what we still have in common with the last frame
+    size_t keep = (idx > 0) ? sharedWithNext[idx - 1] : 0;
+    while (stack.back().depth > keep) stack.pop_back();
+    
+    // Depths later frames will restart from (running minimum of the overlaps ahead)
+    vector<size_t> marks;
+    size_t m = SIZE_MAX;
+    for (int g = idx; g + 1 < totalFrames; g++) {
+        m = min(m, sharedWithNext[g]);
+        if (m <= stack.back().depth) break;
+        if (marks.empty() || m < marks.back()) marks.push_back(m);
+    }
+    reverse(marks.begin(), marks.end());
+    // Over the snapshot budget: keep the deepest mark (the very next frame starts there)
+    // and spread the rest evenly below it; frames between two kept ones repaint the gap
+    size_t room = MAX_SNAPSHOTS - min(MAX_SNAPSHOTS, stack.size() - 1);
+    if (marks.size() > room) {
+        vector<size_t> kept;
+        for (size_t k = 1; k <= room; k++) kept.push_back(marks[k * marks.size() / room - 1]);
+        marks = std::move(kept);
+    }
+    if (marks.empty() || marks.back() != cmds.size()) marks.push_back(cmds.size());
+    
+    FramePtr cur = stack.back().pixels;
+    size_t depth = stack.back().depth;
+    RenderStats st = stack.back().stats;
+    if (depth == cmds.size()) framesShared++;   // nothing of its own - hand out the snapshot
+    
+    for (size_t target : marks) {
+        if (target <= depth) continue;
+        auto next = make_shared<Frame>(*cur);   // copy-on-write
+        paint(*next, cmds, depth, target, st);
+        cur = std::move(next);
+        depth = target;
+        bool wanted = target != cmds.size() || (idx + 1 < totalFrames && sharedWithNext[idx] == target);
+        if (wanted && stack.size() - 1 < MAX_SNAPSHOTS) {
+            stack.push_back({depth, cur, st});
+        }
+    }
+    
+    stats.pixelsDrawn += st.pixelsDrawn;
+    stats.pixelsSkippedOutOfBounds += st.pixelsSkippedOutOfBounds;
+    
+    if (idx == 0) {
+        const Frame& frame0 = *cur;
+        for (const auto& pixel : frame0) {
+            if (pixel.r > 0 || pixel.g > 0 || pixel.b > 0 || pixel.a > 0) {
+                nonBlackInFrame0++;
+            }
+        }
+        HMICX_DEBUG("[DEBUG] 🎨 Non-black pixels in frame 0: "<<nonBlackInFrame0<<" / "<<frame0.size()<<"\n");
+        
+        if constexpr (Log::enabled<Log::Debug>) {
+            cout<<"[DEBUG] 🎨 Sample pixels from frame 0:\n";
+            for (int i = 0; i < min(10, (int)frame0.size()); i++) {
+                auto& p = frame0[i];
+                if (p.r > 0 || p.g > 0 || p.b > 0 || p.a > 0) {
+                    cout<<"[DEBUG]   Pixel "<<i<<": r="<<(int)p.r<<" g="<<(int)p.g<<" b="<<(int)p.b<<" a="<<(int)p.a<<"\n";
+                }
+            }
+        }
+    }
+    
+    nextFrame++;
+    return cur;
+}
+
+void LayeredRenderer::finish() {
+    bandPool.stop();
+    
+    int pixelsDrawn = stats.pixelsDrawn;
+    int pixelsSkippedOutOfBounds = stats.pixelsSkippedOutOfBounds;
+    HMICX_DEBUG("[DEBUG] 🎨 Drew "<<pixelsDrawn<<" pixels total ("<<pixelsPainted<<" actually painted, "
+                <<framesShared<<" frames shared a snapshot)\n");
+    HMICX_DEBUG("[DEBUG] 🎨 Commands processed: "<<commandsProcessed<<"\n");
+    HMICX_DEBUG("[DEBUG] 🎨 Pixels skipped (out of bounds): "<<pixelsSkippedOutOfBounds<<"\n");
+    HMICX_DEBUG("[DEBUG] 🎨 Pixels skipped (wrong frame): "<<pixelsSkippedWrongFrame<<"\n");
+    
+    HMICX_SUMMARY("render", "frames="<<totalFrames<<" width="<<width<<" height="<<height
+                  <<" commands="<<arena.commands.size()<<" pixels_drawn="<<pixelsDrawn
+                  <<" skipped_oob="<<pixelsSkippedOutOfBounds<<" skipped_frame="<<pixelsSkippedWrongFrame
+                  <<" pixels_painted="<<pixelsPainted);
+    
+    if (pixelsDrawn == 0) {
+        cout<<"[WARNING] ⚠️⚠️⚠️ NO PIXELS DRAWN!! Output will be BLACK!!\n";
+    } else if (nonBlackInFrame0 == 0) {
+        cout<<"[WARNING] ⚠️⚠️⚠️ PIXELS WERE DRAWN BUT FRAME 0 IS ALL BLACK!!\n";
+    }
+}
+
+FramePipeline::FramePipeline(LayeredRenderer& renderer_, size_t depth_)
+    : renderer(renderer_), depth(depth_) {
+    if (depth > 0 && renderer.frameCount() > 0) {
+        worker = thread(&FramePipeline::produce, this);
+    }
+}
+
+FramePipeline::~FramePipeline() {
+    stop();
+}
+
+void FramePipeline::stop() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void FramePipeline::produce() {
+    Trace::nameThread("render");
+    try {
+        for (int i = 0; i < renderer.frameCount(); i++) {
+            FramePtr frame = renderer.render(i);
+            unique_lock<mutex> lock(queueMutex);
+            changed.wait(lock, [&] { return stopping || queue.size() < depth; });
+            if (stopping) return;
+            queue.push_back(std::move(frame));
+            peakQueued = max(peakQueued, queue.size());
+            lock.unlock();
+            changed.notify_all();
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(queueMutex);
+        failure = current_exception();
+    }
+    changed.notify_all();
+}
+
+FramePtr FramePipeline::render(int idx) {
+    if (idx != nextFrame || idx >= frameCount()) {
+        throw runtime_error("FramePipeline: frames must be taken in order");
+    }
+    nextFrame++;
+    if (!worker.joinable()) return renderer.render(idx);
+    
+    unique_lock<mutex> lock(queueMutex);
+    changed.wait(lock, [&] { return !queue.empty() || failure; });
+    if (queue.empty()) rethrow_exception(failure);
+    FramePtr frame = std::move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    changed.notify_all();
+    return frame;
+}
+
+void FramePipeline::finish() {
+    stop();
+    if (failure) rethrow_exception(failure);
+    if (depth > 0) {
+        HMICX_DEBUG("[DEBUG] 🚰 Pipeline: up to "<<peakQueued<<" of "<<depth<<" frames waiting for the writer\n");
+    }
+    renderer.finish();
+}
+
+void HMICX::computeDelta(
+        const vector<RGBA>& prev,const vector<RGBA>& curr,int width,
+        vector<uint8_t>& deltaData) {
+    if (prev.size() != curr.size()) throw runtime_error("computeDelta: frame sizes differ");
+    encodeDelta(prev.data(), curr.data(), curr.size(), width, deltaData);
+}
+
+WriteStats HMICX::writeHMICB(ostream& out, int width, int height, int fps, 
+                             int totalFrames, bool loop,
+                             const FrameSource& frames, const EncodeOptions& options) {
+    WriteStats stats;
+    Usage started = threadUsage(), waiting;
+    size_t frameCount = (size_t)max(totalFrames, 0);
+
+    out.write("HMICB", 5);
+    writeU8(out, options.runDeltas ? 2 : 1);   // version
+    writeU16(out, (uint16_t)width);
+    writeU16(out, (uint16_t)height);
+    writeU16(out, (uint16_t)fps);
+    writeU32(out, (uint32_t)totalFrames);
+    writeU8(out, loop ? 1 : 0);
+    writeU8(out, 1);
+    
+    for(int i = 0; i < 14; i++) {
+        writeU8(out, 0);
+    }
+    
+    streampos afterHeader = out.tellp();
+    HMICX_DEBUG("[DEBUG] After header: byte "<<afterHeader<<" (should be 32)\n");
+
+    uint32_t indexSize = frameCount * 9;
+    uint32_t dataStartOffset = 32 + indexSize;
+    
+    HMICX_DEBUG("[DEBUG] Index size: "<<indexSize<<" bytes\n");
+    HMICX_DEBUG("[DEBUG] Frame data will start at byte: "<<dataStartOffset<<"\n");
+
+    streampos indexPos = out.tellp();
+    for (size_t i = 0; i < frameCount; i++) {
+        writeU32(out, 0);
+        writeU32(out, 0);
+        writeU8(out, 0);
+    }
+    
+    streampos dataStart = out.tellp();
+    HMICX_DEBUG("[DEBUG] Data actually starts at byte "<<dataStart<<" (should be "<<dataStartOffset<<")\n");
+    
+    if((uint32_t)dataStart != dataStartOffset) {
+        throw runtime_error("MATH ERROR!! Data start position mismatch!!");
+    }
+
+    vector<FrameIndexEntry> index(frameCount);
+    size_t totalOrig=0, totalOut=0;
+    FramePtr prev;   // frames come out of the renderer one by one, we only hang on to the last
+    size_t lastKeyframe = 0, keyframes = 0;
+
+    for(size_t i=0;i<frameCount;++i){
+        streampos pos = out.tellp();
+        index[i].offset = (uint32_t)pos;
+        
+        Usage w0 = threadUsage();
+        FramePtr cur;
+        {
+            Trace::Span wait("wait for frame", "write");
+            wait.arg("frame", (int64_t)i);
+            cur = frames((int)i);
+        }
+        waiting += threadUsage() - w0;
+        Trace::Span span("write frame", "write");
+        span.arg("frame", (int64_t)i);
+        const auto& frame = *cur;
+        size_t frameSize = frame.size() * sizeof(RGBA);
+        totalOrig += frameSize;
+
+        bool keyframe;
+        vector<uint8_t> deltaData;
+        if (!options.adaptiveKeyframes) {
+            keyframe = (i == 0 || i % 10 == 0);
+        } else {
+            keyframe = (i == 0 || (int)(i - lastKeyframe) >= max(1, options.maxKeyframeDistance));
+        }
+        if (!keyframe) {
+            Trace::Span deltaSpan("delta", "delta");
+            Usage d0 = threadUsage();
+            if (options.runDeltas) {
+                if (prev->size() != frame.size()) throw runtime_error("delta: frame sizes differ");
+                encodeDeltaRuns(prev->data(), frame.data(), frame.size(), deltaData);
+            } else {
+                computeDelta(*prev, frame, width, deltaData);
+            }
+            stats.delta += threadUsage() - d0;
+            stats.deltaBytes += deltaData.size();
+            deltaSpan.arg("frame", (int64_t)i);
+            deltaSpan.arg("bytes", (int64_t)deltaData.size());
+            stats.pixelsCompared += frame.size();
+            // Scene cut or the like: the delta doesn't pay for itself
+            if (options.adaptiveKeyframes && deltaData.size() > options.deltaLimit * frameSize) {
+                keyframe = true;
+            }
+        }
+
+        if(keyframe){
+            out.write((char*)frame.data(), frameSize);
+            index[i].size = (uint32_t)frameSize;
+            index[i].type = FRAME_RAW;
+            totalOut += frameSize;
+            lastKeyframe = i;
+            keyframes++;
+            
+            if(i == 0) {
+                HMICX_DEBUG("[DEBUG] Frame 0 written at byte "<<pos
+                    <<", size="<<frameSize<<" bytes (full frame)\n");
+            }
+        } else {
+            out.write((char*)deltaData.data(), deltaData.size());
+            index[i].size = (uint32_t)deltaData.size();
+            index[i].type = options.runDeltas ? FRAME_DELTA_RUNS : FRAME_DELTA;
+            totalOut += deltaData.size();
+            
+            if(i == 1) {
+                HMICX_DEBUG("[DEBUG] Frame 1 written at byte "<<pos
+                    <<", size="<<deltaData.size()<<" bytes (delta frame)\n");
+            }
+        }
+
+        if(i < 3 || i == frameCount - 1) {
+            HMICX_DEBUG("[DEBUG] Frame "<<i
+                <<": offset="<<index[i].offset
+                <<", size="<<index[i].size
+                <<", type="<<(int)index[i].type<<"\n");
+        }
+        span.arg("bytes", index[i].size);
+        prev = std::move(cur);
+    }
+
+    out.seekp(indexPos);
+    HMICX_DEBUG("[DEBUG] Backpatching index at byte "<<indexPos<<"...\n");
+    
+    for (size_t i = 0; i < index.size(); i++) {
+        writeU32(out, index[i].offset);
+        writeU32(out, index[i].size);
+        writeU8(out, index[i].type);
+    }
+    
+    HMICX_DEBUG("[DEBUG] Index backpatched!!\n");
+    HMICX_DEBUG("[DEBUG] First frame index entry: offset="<<index[0].offset
+        <<", size="<<index[0].size
+        <<", type="<<(int)index[0].type<<"\n");
+    
+    out.seekp(0, ios::end);
+    if(!out) throw runtime_error("failed writing HMICB output");
+
+    HMICX_DEBUG("[DEBUG] Delta compression: "<<totalOrig<<" → "<<totalOut
+        <<" bytes ("<<(totalOrig > 0 ? 100.0*(1.0-totalOut/(double)totalOrig) : 0)<<"% saved)\n");
+    HMICX_SUMMARY("write", "frames="<<frameCount<<" keyframes="<<keyframes<<" raw_bytes="<<totalOrig<<" encoded_bytes="<<totalOut);
+    
+    stats.write = threadUsage() - started - waiting - stats.delta;
+    stats.rawBytes = totalOrig;
+    stats.encodedBytes = totalOut;
+    stats.keyframes = keyframes;
+    return stats;
+}
+
+// 🧱 CHUNKED HMICB7 🧱
+// Instead of one LZ4 block for the whole file, every keyframe group (a raw frame and the
+// deltas after it) is its own independent LZ4 HC block, so a reader can jump to any
+// frame, start playing after the first chunk, or decompress chunks on several threads.
+// Groups over maxChunkSize are cut into several chunks, mid-frame if they must, so chunks
+// are really just byte ranges of the .hmicb: frames [firstFrame, firstFrame + frameCount)
+// start inside one (possibly none), and a frame can continue into the chunks after it.
+//
+//   "HMIC7C"  u8 version (1)  u8 flags (bit 0 = linked)
+//   u32 headerSize            HMICB header + frame index, stored uncompressed below
+//   u32 chunkCount
+//   chunkCount x { u32 firstFrame, u32 frameCount,
+//                  u32 rawOffset, u32 rawSize        where the chunk sits in the .hmicb
+//                  u64 fileOffset, u32 packedSize }  where its LZ4 block sits in this file
+//   header bytes, then the LZ4 blocks
+//
+// Header + the chunks unpacked in order = the .hmicb byte for byte. Linked chunks are
+// compressed with the 64 KB of .hmicb before them as LZ4 dictionary (better ratio on
+// small chunks), so unpacking one needs those bytes - the end of the previous chunk.
+// Plain HMICB7 files start with a u64 size, which can never spell the magic.
+static const char HMICB7_CHUNKED_MAGIC[6] = {'H','M','I','C','7','C'};
+static const uint8_t HMICB7_FLAG_LINKED = 1;
+static const size_t LZ4_WINDOW = 64 * 1024;
+
+struct ChunkEntry {
+    uint32_t firstFrame, frameCount;
+    uint32_t rawOffset, rawSize;
+    uint64_t fileOffset;
+    uint32_t packedSize;
+};
+
+static vector<ChunkEntry> planChunks(const vector<char>& hmicb, size_t maxChunkSize, size_t& headerSize) {
+    if (hmicb.size() < 32 || memcmp(hmicb.data(), "HMICB", 5) != 0) {
+        throw runtime_error("not an HMICB file, can't chunk it");
+    }
+    uint32_t totalFrames = readU32(hmicb.data() + 12);
+    headerSize = 32 + (size_t)totalFrames * 9;
+    if (hmicb.size() < headerSize) throw runtime_error("HMICB frame index is cut off");
+    
+    // Frames are stored back to back in index order, so a group is one byte range
+    vector<ChunkEntry> chunks;
+    for (uint32_t f = 0; f < totalFrames; f++) {
+        const char* e = hmicb.data() + 32 + (size_t)f * 9;
+        uint32_t offset = readU32(e), size = readU32(e + 4);
+        uint8_t type = (uint8_t)e[8];
+        if ((size_t)offset + size > hmicb.size()) throw runtime_error("HMICB frame runs past the end");
+        if (chunks.empty() || type == FRAME_RAW || chunks.back().rawSize >= maxChunkSize) {
+            chunks.push_back({f, 0, offset, 0, 0, 0});
+        }
+        if (offset != chunks.back().rawOffset + chunks.back().rawSize) {
+            throw runtime_error("HMICB frames are not back to back");
+        }
+        chunks.back().frameCount++;
+        // A frame bigger than what's left spills into continuation chunks (no frame starts there)
+        for (uint32_t left = size;;) {
+            ChunkEntry& c = chunks.back();
+            uint32_t take = (uint32_t)min<size_t>(left, maxChunkSize - c.rawSize);
+            c.rawSize += take;
+            left -= take;
+            if (left == 0) break;
+            chunks.push_back({f + 1, 0, c.rawOffset + c.rawSize, 0, 0, 0});
+        }
+    }
+    return chunks;
+}
+
+// stream = the run's LZ4 stream for linked chunks, null for independent ones
+static vector<char> compressChunk(const vector<char>& hmicb, const ChunkEntry& c, int level, LZ4_streamHC_t* stream) {
+    int bound = LZ4_compressBound((int)c.rawSize);
+    vector<char> packed(bound > 0 ? bound : 1);
+    const char* src = hmicb.data() + c.rawOffset;
+    Trace::Span span("lz4 chunk", "compress");
+    span.arg("raw_offset", c.rawOffset);
+    span.arg("raw_bytes", c.rawSize);
+    int n = stream ? LZ4_compress_HC_continue(stream, src, packed.data(), (int)c.rawSize, bound)
+                   : LZ4_compress_HC(src, packed.data(), (int)c.rawSize, bound, level);
+    if (n <= 0 && c.rawSize > 0) throw runtime_error("LZ4 compression failed!! Yikes!! 💀");
+    packed.resize(max(n, 0));
+    return packed;
+}
+
+// Linked chunks follow each other in the .hmicb, so a run of them is one LZ4 stream:
+// every block sees the (up to) 64 KB before it, which is what the reader hands it as
+// dictionary. Only the run's first chunk loads a dictionary, so tiny chunks don't each
+// pay for a fresh HC state and 64 KB of hashing
+static void compressLinkedRun(const vector<char>& hmicb, const vector<ChunkEntry>& chunks, size_t from, size_t to,
+                              vector<vector<char>>& packed, const CompressOptions& options) {
+    unique_ptr<LZ4_streamHC_t, int(*)(LZ4_streamHC_t*)> stream(LZ4_createStreamHC(), LZ4_freeStreamHC);
+    if (!stream) throw runtime_error("out of memory for LZ4 HC stream");
+    LZ4_resetStreamHC_fast(stream.get(), options.level);
+    size_t dictSize = min<size_t>(LZ4_WINDOW, chunks[from].rawOffset);
+    LZ4_loadDictHC(stream.get(), hmicb.data() + chunks[from].rawOffset - dictSize, (int)dictSize);
+    for (size_t i = from; i < to; i++) packed[i] = compressChunk(hmicb, chunks[i], options.level, stream.get());
+}
+
+static size_t writeChunkedHMICB7(const vector<char>& hmicb, ostream& out,
+                                 const CompressOptions& options) {
+    size_t headerSize = 0;
+    vector<ChunkEntry> chunks = planChunks(hmicb, max<size_t>(1, options.maxChunkSize), headerSize);
+    
+    // Chunks don't depend on each other's output, so they all go at once - linked ones in
+    // a few runs per thread, each run one stream
+    unsigned threads = options.threads ? options.threads : max(1u, thread::hardware_concurrency());
+    vector<vector<char>> packed(chunks.size());
+    if (options.linked) {
+        size_t runs = min(chunks.size(), (size_t)threads * 4);
+        parallelFor(runs, threads, [&](size_t r) {
+            compressLinkedRun(hmicb, chunks, r * chunks.size() / runs, (r + 1) * chunks.size() / runs, packed, options);
+        });
+    } else {
+        parallelFor(chunks.size(), threads, [&](size_t i) {
+            packed[i] = compressChunk(hmicb, chunks[i], options.level, nullptr);
+        });
+    }
+    
+    out.write(HMICB7_CHUNKED_MAGIC, 6);
+    writeU8(out, 1);
+    writeU8(out, options.linked ? HMICB7_FLAG_LINKED : 0);
+    writeU32(out, (uint32_t)headerSize);
+    writeU32(out, (uint32_t)chunks.size());
+    
+    uint64_t fileOffset = 16 + chunks.size() * 28 + headerSize;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        ChunkEntry& c = chunks[i];
+        c.fileOffset = fileOffset;
+        c.packedSize = (uint32_t)packed[i].size();
+        fileOffset += c.packedSize;
+        
+        writeU32(out, c.firstFrame);
+        writeU32(out, c.frameCount);
+        writeU32(out, c.rawOffset);
+        writeU32(out, c.rawSize);
+        writeU64(out, c.fileOffset);
+        writeU32(out, c.packedSize);
+    }
+    out.write(hmicb.data(), headerSize);
+    for (const auto& block : packed) out.write(block.data(), block.size());
+    if(!out) throw runtime_error("failed writing HMICB7 output");
+    
+    HMICX_DEBUG("[DEBUG] 🧱 "<<chunks.size()<<" chunks for "<<readU32(hmicb.data() + 12)<<" frames"
+                <<(options.linked ? " (linked)" : "")<<", level "<<options.level<<", "
+                <<min<size_t>(threads, chunks.size())<<" threads, index + header "
+                <<(16 + chunks.size() * 28 + headerSize)<<" bytes\n");
+    return (size_t)fileOffset;
+}
+
+// 🔥🔥 LZ4 COMPRESSION GO BRRRRR!! 🚀🚀
+size_t HMICX::compressToHMICB7(const vector<char>& uncompressedData, ostream& out,
+                               const CompressOptions& options) {
+    // The encoder handed us the HMICB straight from memory, no .hmicb detour over the disk
+    streamsize fileSize = (streamsize)uncompressedData.size();
+    HMICX_DEBUG("[DEBUG] 📖 Compressing "<<fileSize<<" bytes of HMICB\n");
+    
+    if (options.chunked) {
+        size_t totalWritten = writeChunkedHMICB7(uncompressedData, out, options);
+        HMICX_DEBUG("[DEBUG] 📊 Compression ratio: "<<fileSize<<" → "<<totalWritten
+            <<" bytes ("<<100.0 * (1.0 - (double)totalWritten / (double)fileSize)<<"% smaller)\n");
+        HMICX_SUMMARY("compress", "bytes_in="<<fileSize<<" bytes_out="<<totalWritten<<" chunked=1");
+        return totalWritten;
+    }
+    
+    // Get max compressed size bound (LZ4 needs this for buffer allocation)
+    int maxCompressedSize = LZ4_compressBound(fileSize);
+    vector<char> compressedData(maxCompressedSize);
+    
+    HMICX_DEBUG("[DEBUG] 🔨 Compressing with LZ4 HC (high compression mode)... LETS GOOOO!!\n");
+    
+    // Use LZ4_compress_HC for better compression (level 9 = max compression)
+    // If you want SPEED instead of compression, use LZ4_compress_default()
+    Trace::Span span("lz4", "compress");
+    int compressedSize = LZ4_compress_HC(
+        uncompressedData.data(),
+        compressedData.data(),
+        fileSize,
+        maxCompressedSize,
+        options.level  // 🔥 MAX COMPRESSION LEVEL by default!! (level 12)
+    );
+    span.arg("bytes_in", fileSize);
+    span.arg("bytes_out", compressedSize);
+    
+    if(compressedSize <= 0) {
+        throw runtime_error("LZ4 compression failed!! Yikes!! 💀");
+    }
+    
+    // Store original size first (8 bytes for decompression)
+    uint64_t origSize = fileSize;
+    out.write((char*)&origSize, sizeof(uint64_t));
+    
+    // Write compressed data
+    out.write(compressedData.data(), compressedSize);
+    if(!out) throw runtime_error("failed writing HMICB7 output");
+    
+    size_t totalWritten = compressedSize + sizeof(uint64_t);
+    double ratio = 100.0 * (1.0 - (double)totalWritten / (double)fileSize);
+    
+    HMICX_DEBUG("[DEBUG] 💾 Wrote "<<totalWritten<<" bytes of HMICB7\n");
+    HMICX_DEBUG("[DEBUG]    (original size header: 8 bytes, compressed data: "<<compressedSize<<" bytes)\n");
+    HMICX_DEBUG("[DEBUG] 📊 Compression ratio: "<<fileSize<<" → "<<totalWritten
+        <<" bytes ("<<ratio<<"% smaller)\n");
+    HMICX_DEBUG("[DEBUG] ⚡ LZ4 was probably WAY faster than ZSTD btw!! No cap!! 🚀\n");
+    HMICX_SUMMARY("compress", "bytes_in="<<fileSize<<" bytes_out="<<totalWritten);
+    return totalWritten;
+}
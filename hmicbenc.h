@@ -0,0 +1,253 @@
+#pragma once
+#include "hmicx.h"
+#include "hmicblend.h"
+#include "hmicmetrics.h"
+#include <lz4hc.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace HMICX {
+
+    // 🏭 HMICB ENCODER - parsed commands → frames → .hmicb → .hmicb7
+    //
+    //   LayeredRenderer renderer(arena, palette, w, h, frames);
+    //   FramePipeline pipeline(renderer);
+    //   writeHMICB(out, w, h, fps, frames, loop, [&](int i) { return pipeline.render(i); });
+    //   pipeline.finish();
+    //
+    // Every stage works on its own, so the converter, the batch runs and the benchmark
+    // all drive the exact same code.
+
+    using Frame = std::vector<RGBA>;
+    using FramePtr = std::shared_ptr<const Frame>;
+
+    // How writeHMICB encodes frames. Defaults = the classic version 1 files every viewer reads
+    struct EncodeOptions {
+        bool runDeltas = false;   // type 2 run-length/palette deltas (needs a version 2 reader)
+        // Keyframes: fixed = frame 0 and every 10th. Adaptive = a delta whenever it is under
+        // deltaLimit of a raw frame, a keyframe otherwise, and at least every maxKeyframeDistance
+        // frames so seeking never has to replay too many deltas
+        bool adaptiveKeyframes = false;
+        double deltaLimit = 0.5;
+        int maxKeyframeDistance = 60;
+    };
+
+    // How the HMICB gets packed into HMICB7. Defaults = the classic single LZ4 block
+    struct CompressOptions {
+        bool chunked = false;               // chunked layout instead of one block
+        bool linked = false;                // chunks may refer back into the 64 KB before them
+        int level = LZ4HC_CLEVEL_MAX;       // LZ4 HC level, 1..12
+        unsigned threads = 0;               // chunks compressed side by side, 0 = every core
+        size_t maxChunkSize = 1 << 20;      // bigger keyframe groups (or frames) are split up
+    };
+
+    struct RenderStats {
+        int pixelsDrawn = 0;
+        int pixelsSkippedOutOfBounds = 0;
+    };
+
+    // 🧠 In-memory output: an ostream target backed by a vector, seekable like a file so
+    // the writer can backpatch its frame index, and handing the bytes over without a copy
+    class MemorySink : public std::streambuf {
+    public:
+        const std::vector<char>& bytes() const { return data; }
+
+    protected:
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            if (pos + (size_t)n > data.size()) data.resize(pos + (size_t)n);
+            std::memcpy(data.data() + pos, s, (size_t)n);
+            pos += (size_t)n;
+            return n;
+        }
+
+        int_type overflow(int_type c) override {
+            if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+            char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+            return c;
+        }
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            if (!(which & std::ios_base::out)) return pos_type(off_type(-1));
+            off_type base = (dir == std::ios_base::beg) ? 0
+                          : (dir == std::ios_base::cur) ? (off_type)pos : (off_type)data.size();
+            if (base + off < 0) return pos_type(off_type(-1));
+            pos = (size_t)(base + off);
+            return pos_type((off_type)pos);
+        }
+
+        pos_type seekpos(pos_type p, std::ios_base::openmode which) override {
+            return seekoff(off_type(p), std::ios_base::beg, which);
+        }
+
+    private:
+        std::vector<char> data;
+        size_t pos = 0;
+    };
+
+    // 🧵 Threads that stay around for a whole animation and run one job at a time:
+    // run(count, fn) calls fn(0..count-1) spread over them and the caller, and returns
+    // once all are done (rethrowing the first exception). stop() joins them; after that
+    // run() still works, on the caller alone
+    class BandPool {
+    public:
+        explicit BandPool(unsigned threads);   // threads - 1 helpers, the caller is the last one
+        ~BandPool() { stop(); }
+        BandPool(const BandPool&) = delete;
+        BandPool& operator=(const BandPool&) = delete;
+
+        void run(size_t count, const std::function<void(size_t)>& fn);
+        void stop();
+
+    private:
+        std::vector<std::thread> helpers;
+        std::mutex jobMutex;
+        std::condition_variable wake, done;
+        const std::function<void(size_t)>* job = nullptr;
+        size_t jobSize = 0;
+        std::atomic<size_t> next{0};
+        uint64_t generation = 0;   // bumped per job so helpers know there's a new one
+        size_t busy = 0;           // helpers still on the current job
+        bool stopping = false;
+        std::exception_ptr failure;
+
+        void help(unsigned index);
+        void drain();
+    };
+
+    // 🧅 LAYERED RENDERER 🧅
+    // Frame f is "paint every command covering f, in file order, onto a clear frame".
+    // Frames that start with the same commands (F1-40 background, F1-20 layer...) share
+    // that prefix, so it is painted once into an immutable snapshot and later frames
+    // copy it and only paint what differs - copy-on-write. Snapshots live on a stack
+    // (a DFS over the prefix tree of the frames' command lists), only at the depths some
+    // later frame will branch off from, and at most 8 of them - deeper nesting repaints
+    // from the closest snapshot kept - so memory stays at a few frames.
+    // Frames are made one at a time when render() asks for them. Since every frame is
+    // still the exact same sequence of paint operations, the pixels are identical.
+    //
+    // blend: how semi-transparent colors composite (Classic = the historical math).
+    // threads: 1 = serial, 0 = one per hardware thread - each paint is split into
+    // horizontal bands that run side by side on threads made once, in the constructor
+    class LayeredRenderer {
+    public:
+        LayeredRenderer(const CommandArena& arena, const Palette& palette, int width, int height,
+                        int totalFrames, BlendMode blend = BlendMode::Classic, unsigned threads = 1);
+
+        int frameCount() const { return totalFrames; }
+        // Frames have to be asked for in order: 0, 1, 2, ...
+        FramePtr render(int idx);
+        // Stats, summary and sanity warnings once every frame is out; joins the band threads
+        void finish();
+
+        // What render() has cost so far: wall time of the threads that called it, CPU and
+        // allocations of those plus the band helpers - read it once the frames are out
+        const Usage& cost() const { return renderCost; }
+        size_t paintedPixels() const { return pixelsPainted; }
+
+    private:
+        struct Snapshot {
+            size_t depth;          // how many of the frame's commands are painted in
+            FramePtr pixels;
+            RenderStats stats;     // everything that went into it
+        };
+
+        const CommandArena& arena;
+        const Palette& palette;
+        int width, height, totalFrames;
+        BlendMode blend;
+        unsigned threads;
+        BandPool bandPool;
+
+        std::vector<std::vector<uint32_t>> frameCommands;   // painter's order per frame
+        std::vector<size_t> sharedWithNext;                 // common prefix length of frame f and f+1
+        std::vector<Snapshot> stack;                        // bottom = clear frame at depth 0
+        int nextFrame = 0;
+
+        RenderStats stats;                        // as if every frame was painted from scratch
+        size_t pixelsPainted = 0;                 // what we actually painted
+        int commandsProcessed = 0;
+        int pixelsSkippedWrongFrame = 0;
+        int nonBlackInFrame0 = 0;
+        int framesShared = 0;
+        Usage renderCost;
+
+        FramePtr renderFrame(int idx);
+        void paint(Frame& frame, const std::vector<uint32_t>& cmds, size_t from, size_t to, RenderStats& st);
+    };
+
+    // 🚰 FRAME PIPELINE 🚰
+    // Renders ahead on a background thread while the writer delta-codes and writes the
+    // frames before it. The hand-off queue holds at most `depth` frames, so however long
+    // the animation is, memory stays at: the queue + the frame being rendered + the one
+    // being written + the writer's previous frame + the renderer's (at most 8) snapshots.
+    // depth 0 = no thread, frames are rendered right when the writer asks (same bytes)
+    class FramePipeline {
+    public:
+        FramePipeline(LayeredRenderer& renderer, size_t depth = 2);
+        ~FramePipeline();
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        int frameCount() const { return renderer.frameCount(); }
+        // Next frame in order, blocks until the render thread has it
+        FramePtr render(int idx);
+        // Joins the render thread and prints the renderer's stats
+        void finish();
+
+    private:
+        LayeredRenderer& renderer;
+        size_t depth;
+        std::deque<FramePtr> queue;
+        std::mutex queueMutex;
+        std::condition_variable changed;
+        bool stopping = false;
+        std::exception_ptr failure;
+        int nextFrame = 0;
+        size_t peakQueued = 0;
+        std::thread worker;
+
+        void produce();
+        void stop();
+    };
+
+    // Where writeHMICB gets frame i from - asked for 0, 1, 2, ... in order
+    using FrameSource = std::function<FramePtr(int)>;
+
+    // Type 1 delta of two equally sized frames (throws if they aren't)
+    void computeDelta(const std::vector<RGBA>& prev, const std::vector<RGBA>& curr, int width,
+                      std::vector<uint8_t>& deltaData);
+
+    // What writeHMICB did, split into delta coding and everything else it did itself
+    // (waiting for frames not counted). Costs are of the writing thread
+    struct WriteStats {
+        Usage delta, write;
+        uint64_t rawBytes = 0;        // the frames as they came in
+        uint64_t encodedBytes = 0;    // frame data written (raw keyframes + deltas)
+        uint64_t deltaBytes = 0;      // every delta made, also the ones dropped for a keyframe
+        uint64_t pixelsCompared = 0;  // by the delta coder
+        size_t keyframes = 0;
+    };
+
+    // Encodes totalFrames frames into any seekable stream: a file, or a MemorySink when
+    // it gets compressed next. Throws runtime_error when the stream fails
+    WriteStats writeHMICB(std::ostream& out, int width, int height, int fps, int totalFrames, bool loop,
+                    const FrameSource& frames, const EncodeOptions& options = {});
+
+    // 🔥 Packs a whole .hmicb into HMICB7 and writes it to out. Returns the bytes written
+    size_t compressToHMICB7(const std::vector<char>& uncompressedData, std::ostream& out,
+                            const CompressOptions& options = {});
+
+}  // namespace HMICX
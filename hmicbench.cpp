@@ -0,0 +1,343 @@
+#include "hmicx.h"
+#include "hmicblend.h"
+#include "hmicbenc.h"
+#include "hmicdelta.h"
+#include "hmicmetrics.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace HMICX;
+
+// ⏱️ HMICB BENCHMARK ⏱️
+// Times every stage of the converter on its own - parse, render, delta, write, compress -
+// and the whole thing end to end, over the bundled .hmic files and synthetic animations.
+// Every stage runs `reps` times on the same input, best and median are reported, plus how
+// many heap allocations one run makes. Build with -DHMICX_LOG_LEVEL=0 or the [DEBUG]
+// output ends up in the timings.
+//
+//   hmicbench                          bundled files + the default synthetic set
+//   hmicbench -r 10 -t 1 a.hmic        10 reps, single threaded, just a.hmic
+//   hmicbench --synth 120,640x360,0.3,0.5   120 frames, 30% P= commands, half translucent
+//   hmicbench --no-synth --no-files --synth ...   only what's on the command line
+
+struct BenchOptions {
+    int reps = 5;
+    unsigned threads = 0;   // parser/renderer/compressor threads, 0 = every core
+    CompressOptions pack;
+    EncodeOptions encode;
+};
+
+// One synthetic animation: F blocks of 1-4 frames, each with a handful of colors
+struct SynthSpec {
+    int frames = 60;
+    int width = 320, height = 240;
+    double pointShare = 0.5;   // P= commands vs PL= lines
+    double alphaShare = 0.0;   // colors with 0 < alpha < 255
+};
+
+static string synthName(const SynthSpec& s) {
+    ostringstream name;
+    name<<"synth "<<s.frames<<"f "<<s.width<<"x"<<s.height<<" P"<<int(s.pointShare * 100 + 0.5)
+        <<"% A"<<int(s.alphaShare * 100 + 0.5)<<"%";
+    return name.str();
+}
+
+// Same seed, same text - runs before and after a change see identical input
+static string makeSynthetic(const SynthSpec& s) {
+    mt19937 rng(12345);
+    auto pick = [&](int lo, int hi) { return uniform_int_distribution<int>(lo, hi)(rng); };
+    auto chance = [&](double p) { return uniform_real_distribution<double>(0, 1)(rng) < p; };
+
+    ostringstream out;
+    out<<"info{\nDISPLAY="<<s.width<<"X"<<s.height<<"\nFPS=10\nF="<<s.frames<<"\nLOOP=Y\n}\n\n";
+
+    auto color = [&] {
+        int a = chance(s.alphaShare) ? pick(1, 254) : 255;
+        out<<"  rgba("<<pick(0, 255)<<","<<pick(0, 255)<<","<<pick(0, 255)<<","<<a<<"){\n";
+    };
+    auto commands = [&](int count) {
+        for (int k = 0; k < count; k++) {
+            int x = pick(0, s.width - 1), y = pick(0, s.height - 1);
+            if (chance(s.pointShare)) {
+                out<<"    P="<<x<<"x"<<y<<"\n";
+            } else if (chance(0.5)) {
+                out<<"    PL="<<x<<"x"<<y<<"-"<<pick(0, s.width - 1)<<"x"<<y<<"\n";
+            } else {
+                out<<"    PL="<<x<<"x"<<y<<"-"<<x<<"x"<<pick(0, s.height - 1)<<"\n";
+            }
+        }
+    };
+
+    // Background that every frame shares, then short-lived layers on top
+    out<<"F1-"<<s.frames<<"{\n";
+    out<<"  rgba("<<pick(0, 255)<<","<<pick(0, 255)<<","<<pick(0, 255)<<",255){\n";
+    for (int y = 0; y < s.height; y++) out<<"    PL=0x"<<y<<"-"<<(s.width - 1)<<"x"<<y<<"\n";
+    out<<"  }\n}\n";
+
+    for (int f = 1; f <= s.frames;) {
+        int last = min(s.frames, f + pick(0, 3));
+        out<<"F"<<f;
+        if (last > f) out<<"-"<<last;
+        out<<"{\n";
+        for (int c = 0; c < 6; c++) {
+            color();
+            commands(max(1, (s.width + s.height) / 16));
+            out<<"  }\n";
+        }
+        out<<"}\n";
+        f = last + 1;
+    }
+    return out.str();
+}
+
+struct Props {
+    int width = 5, height = 5, fps = 2, frames = 1;
+    bool loop = true;
+};
+
+// Same reading of the info{} block as the converter
+static Props readHeader(const Parser& p) {
+    Props pr;
+    for (auto& [k, v] : p.getHeader()) {
+        string key = k;
+        transform(key.begin(), key.end(), key.begin(), ::toupper);
+        if (key == "DISPLAY") {
+            if (sscanf(v.c_str(), "%dx%d", &pr.width, &pr.height) != 2) sscanf(v.c_str(), "%dX%d", &pr.width, &pr.height);
+        }
+        else if (key == "FPS") pr.fps = stoi(v);
+        else if (key == "F") pr.frames = stoi(v);
+        else if (key == "LOOP") pr.loop = (v == "Y" || v == "y" || v == "1");
+    }
+    return pr;
+}
+
+// What one stage moved per run, for the throughput columns (0 = not meaningful)
+struct Work {
+    double bytes = 0, pixels = 0, frames = 0;
+};
+
+struct Result {
+    double best = 0, median = 0;   // seconds
+    size_t allocs = 0, allocBytes = 0;
+};
+
+// Runs fn `reps` times; allocations are from the last run
+template <class Fn>
+static Result measure(int reps, Fn fn) {
+    vector<double> times;
+    Result r;
+    for (int i = 0; i < max(reps, 1); i++) {
+        Usage t0 = processUsage();
+        fn();
+        Usage used = processUsage() - t0;   // allocations counted by hmicmetrics.cpp
+        r.allocs = used.allocs;
+        r.allocBytes = used.allocBytes;
+        times.push_back(used.wall);
+    }
+    sort(times.begin(), times.end());
+    r.best = times.front();
+    r.median = times[times.size() / 2];
+    return r;
+}
+
+static void report(const string& stage, const Result& r, const Work& w) {
+    auto rate = [&](double amount, double scale) -> string {
+        if (amount <= 0 || r.best <= 0) return "-";
+        ostringstream s;
+        s.setf(ios::fixed);
+        s.precision(1);
+        s<<amount / scale / r.best;
+        return s.str();
+    };
+    printf("  %-10s %10.3f %10.3f %10s %10s %10s %10zu %10.2f\n", stage.c_str(),
+           r.best * 1000, r.median * 1000, rate(w.bytes, 1e6).c_str(), rate(w.pixels, 1e6).c_str(),
+           rate(w.frames, 1).c_str(), r.allocs, r.allocBytes / 1e6);
+}
+
+static void benchCase(const string& name, const string& text, const BenchOptions& o) {
+    printf("\n%s (%.2f MB)\n", name.c_str(), text.size() / 1e6);
+    printf("  %-10s %10s %10s %10s %10s %10s %10s %10s\n", "stage", "best ms", "median ms",
+           "MB/s", "Mpx/s", "frames/s", "allocs", "alloc MB");
+
+    // 1️⃣ parse - MB/s of .hmic text
+    Result parse = measure(o.reps, [&] {
+        Parser p = Parser::fromBuffer(text);
+        p.parseArena(o.threads);
+    });
+    Parser p = Parser::fromBuffer(text);
+    p.parseArena(o.threads);
+    Props pr = readHeader(p);
+    if (pr.width <= 0 || pr.height <= 0 || pr.width > 10000 || pr.height > 10000 || pr.frames <= 0) {
+        printf("  skipped: bad DISPLAY or F\n");
+        return;
+    }
+    double framePixels = (double)pr.width * pr.height;
+    double allPixels = framePixels * pr.frames;
+    report("parse", parse, {(double)text.size(), 0, 0});
+
+    // 2️⃣ render - every frame, in order, as the writer asks for them
+    vector<FramePtr> frames;
+    Result render = measure(o.reps, [&] {
+        frames.clear();
+        LayeredRenderer renderer(p.getArena(), p.getPalette(), pr.width, pr.height, pr.frames,
+                                 BlendMode::Classic, o.threads);
+        for (int i = 0; i < pr.frames; i++) frames.push_back(renderer.render(i));
+        renderer.finish();
+    });
+    report("render", render, {allPixels * 4, allPixels, (double)pr.frames});
+
+    // 3️⃣ delta - every frame against the one before with the coder the writer uses
+    // (type 1, or type 2 runs with --runs), MB/s of both frames read
+    vector<uint8_t> delta;
+    Result deltas = measure(o.reps, [&] {
+        for (size_t i = 1; i < frames.size(); i++) {
+            const Frame& prev = *frames[i - 1];
+            const Frame& curr = *frames[i];
+            if (o.encode.runDeltas) encodeDeltaRuns(prev.data(), curr.data(), curr.size(), delta);
+            else computeDelta(prev, curr, pr.width, delta);
+        }
+    });
+    double pairs = frames.size() > 1 ? (double)frames.size() - 1 : 0;
+    report(o.encode.runDeltas ? "delta runs" : "delta", deltas, {pairs * framePixels * 8, pairs * framePixels, pairs});
+
+    // 4️⃣ write - encode the rendered frames into memory, MB/s of .hmicb out
+    vector<char> hmicb;
+    Result write = measure(o.reps, [&] {
+        MemorySink sink;
+        ostream out(&sink);
+        writeHMICB(out, pr.width, pr.height, pr.fps, pr.frames, pr.loop,
+                   [&](int i) { return frames[i]; }, o.encode);
+        hmicb = sink.bytes();
+    });
+    report("write", write, {(double)hmicb.size(), allPixels, (double)pr.frames});
+    frames.clear();
+
+    // 5️⃣ compress - MB/s of .hmicb in
+    Result compress = measure(o.reps, [&] {
+        MemorySink sink;
+        ostream out(&sink);
+        compressToHMICB7(hmicb, out, o.pack);
+    });
+    report("compress", compress, {(double)hmicb.size(), 0, 0});
+
+    // 6️⃣ all of it, the way the converter does it - MB/s of .hmic text
+    unsigned cores = o.threads ? o.threads : thread::hardware_concurrency();
+    Result all = measure(o.reps, [&] {
+        Parser q = Parser::fromBuffer(text);
+        q.parseArena(o.threads);
+        LayeredRenderer renderer(q.getArena(), q.getPalette(), pr.width, pr.height, pr.frames,
+                                 BlendMode::Classic, o.threads);
+        FramePipeline fr(renderer, cores > 1 ? 2 : 0);
+        MemorySink sink;
+        ostream mem(&sink);
+        writeHMICB(mem, pr.width, pr.height, pr.fps, pr.frames, pr.loop,
+                   [&](int i) { return fr.render(i); }, o.encode);
+        fr.finish();
+        MemorySink packed;
+        ostream out(&packed);
+        compressToHMICB7(sink.bytes(), out, o.pack);
+    });
+    report("end2end", all, {(double)text.size(), allPixels, (double)pr.frames});
+}
+
+static bool readFile(const string& path, string& text) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    ostringstream s;
+    s<<in.rdbuf();
+    text = s.str();
+    return true;
+}
+
+// "frames,WxH,pointShare,alphaShare" - anything left out keeps its default
+static SynthSpec parseSynth(const string& arg) {
+    SynthSpec s;
+    string parts[4];
+    istringstream in(arg);
+    for (int i = 0; i < 4 && getline(in, parts[i], ','); i++) {}
+    if (!parts[0].empty()) s.frames = stoi(parts[0]);
+    if (!parts[1].empty() && sscanf(parts[1].c_str(), "%dx%d", &s.width, &s.height) != 2) {
+        throw runtime_error("bad resolution in --synth: " + parts[1]);
+    }
+    if (!parts[2].empty()) s.pointShare = stod(parts[2]);
+    if (!parts[3].empty()) s.alphaShare = stod(parts[3]);
+    if (s.frames <= 0 || s.width <= 0 || s.height <= 0) throw runtime_error("bad --synth: " + arg);
+    return s;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions o;
+    vector<string> files;
+    vector<SynthSpec> synth;
+    bool defaultFiles = true, defaultSynth = true;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string a = argv[i];
+            auto value = [&]() -> string {
+                if (i + 1 >= argc) throw runtime_error(a + " needs a value");
+                return argv[++i];
+            };
+            if (a == "-r") o.reps = max(1, stoi(value()));
+            else if (a == "-t") o.threads = (unsigned)max(0, stoi(value()));
+            else if (a == "--level") o.pack.level = min(max(stoi(value()), 1), (int)LZ4HC_CLEVEL_MAX);
+            else if (a == "--chunked") o.pack.chunked = true;
+            else if (a == "--linked") o.pack.chunked = o.pack.linked = true;
+            else if (a == "--runs") o.encode.runDeltas = true;
+            else if (a == "--adaptive") o.encode.adaptiveKeyframes = true;
+            else if (a == "--synth") synth.push_back(parseSynth(value()));
+            else if (a == "--no-synth") defaultSynth = false;
+            else if (a == "--no-files") defaultFiles = false;
+            else if (a == "-h" || a == "--help") {
+                cout<<"usage: hmicbench [-r reps] [-t threads] [--level N] [--chunked|--linked] [--runs] [--adaptive]\n"
+                      "                 [--synth frames,WxH,pointShare,alphaShare]... [--no-synth] [--no-files] [file.hmic...]\n";
+                return 0;
+            }
+            else if (!a.empty() && a[0] == '-') throw runtime_error("unknown option " + a);
+            else { files.push_back(a); defaultFiles = false; }
+        }
+        if (!synth.empty()) defaultSynth = false;
+        if (defaultFiles) {
+            files = {"cobson-miku.hmic",
+                     "375-3751201_transparent-chibi-miku-png-hatsune-miku-chibi-transparent.hmic"};
+        }
+        if (defaultSynth) {
+            synth = {
+                {60, 320, 240, 0.5, 0.0},    // a bit of everything
+                {60, 320, 240, 0.5, 0.5},    // blend heavy
+                {30, 640, 480, 1.0, 0.0},    // P= only
+                {30, 640, 480, 0.0, 0.0},    // PL= only
+                {600, 160, 120, 0.5, 0.1},   // long and small: per-frame overhead
+            };
+        }
+
+        printf("hmicbench: %d reps, %u threads (%u cores), LZ4 level %d%s%s\n", o.reps, o.threads,
+               thread::hardware_concurrency(), o.pack.level,
+               o.pack.chunked ? (o.pack.linked ? ", chunked+linked" : ", chunked") : "",
+               o.encode.runDeltas ? ", run deltas" : "");
+
+        for (const string& f : files) {
+            string text;
+            if (!readFile(f, text)) {
+                printf("\n%s: not found, skipped\n", f.c_str());
+                continue;
+            }
+            benchCase(f, text, o);
+        }
+        for (const SynthSpec& s : synth) benchCase(synthName(s), makeSynthetic(s), o);
+    } catch (const exception& e) {
+        cerr<<"❌ ERROR: "<<e.what()<<"\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "hmicbreader.h"
+#include "hmicdelta.h"
+#include <lz4.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace HMICX;
+
+namespace {
+
+    uint32_t readU16(const char* p) {
+        const uint8_t* b = (const uint8_t*)p;
+        return b[0] | (b[1] << 8);
+    }
+
+    uint32_t readU32(const char* p) {
+        const uint8_t* b = (const uint8_t*)p;
+        return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+    }
+
+    uint64_t readU64(const char* p) {
+        return readU32(p) | ((uint64_t)readU32(p + 4) << 32);
+    }
+
+    constexpr size_t LZ4_WINDOW = 64 * 1024;
+    // LZ4 can't unpack to more than ~255x its input (every extra length byte is worth 255),
+    // so anything claiming more is damaged - checked before we allocate for it
+    constexpr uint64_t LZ4_MAX_RATIO = 255;
+
+    bool plausibleBlock(uint64_t packedSize, uint64_t rawSize) {
+        return packedSize <= LZ4_MAX_INPUT_SIZE && rawSize <= LZ4_MAX_INPUT_SIZE
+            && rawSize <= packedSize * LZ4_MAX_RATIO;
+    }
+
+}  // namespace
+
+HMICBReader HMICBReader::open(const string& path) {
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) throw runtime_error("Cannot open file: " + path);
+    streamsize size = in.tellg();
+    in.seekg(0);
+    vector<char> bytes((size_t)max<streamsize>(size, 0));
+    if (!in.read(bytes.data(), size)) throw runtime_error("Failed to read file: " + path);
+    return HMICBReader(std::move(bytes));
+}
+
+HMICBReader HMICBReader::fromBuffer(vector<char> bytes) {
+    return HMICBReader(std::move(bytes));
+}
+
+HMICBReader::HMICBReader(vector<char> bytes) : file(std::move(bytes)) {
+    if (file.size() >= 5 && memcmp(file.data(), "HMICB", 5) == 0) {
+        raw = std::move(file);   // plain .hmicb, nothing to unpack
+        file.clear();
+    } else if (file.size() >= 16 && memcmp(file.data(), "HMIC7C", 6) == 0) {
+        loadChunked();
+    } else if (file.size() >= 8) {
+        // Single-block .hmicb7: u64 size, then one LZ4 block with everything
+        uint64_t originalSize = readU64(file.data());
+        if (!plausibleBlock(file.size() - 8, originalSize)) {
+            throw runtime_error("HMICB7 block size " + to_string(originalSize) + " is impossible for a "
+                                + to_string(file.size()) + " byte file");
+        }
+        raw.resize((size_t)originalSize);
+        int n = LZ4_decompress_safe(file.data() + 8, raw.data(), (int)(file.size() - 8), (int)originalSize);
+        if (n < 0) throw runtime_error("LZ4 decompression failed");
+        raw.resize((size_t)n);
+        file = vector<char>();
+    } else {
+        throw runtime_error("not an HMICB/HMICB7 file");
+    }
+    loadIndex();
+}
+
+void HMICBReader::loadChunked() {
+    if (file[6] != 1) throw runtime_error("unsupported chunked HMICB7 version " + to_string((int)file[6]));
+    uint8_t flags = (uint8_t)file[7];
+    if (flags & ~1u) throw runtime_error("unknown chunked HMICB7 flags " + to_string((int)flags));
+    linked = (flags & 1) != 0;
+
+    uint32_t headerSize = readU32(file.data() + 8);
+    uint32_t chunkCount = readU32(file.data() + 12);
+    size_t tableEnd = 16 + (size_t)chunkCount * 28;
+    if (file.size() < tableEnd || file.size() - tableEnd < headerSize) {
+        throw runtime_error("chunked HMICB7 index is cut off");
+    }
+
+    size_t rawSize = headerSize;
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        const char* e = file.data() + 16 + (size_t)i * 28;
+        Chunk c{readU32(e + 8), readU32(e + 12), readU64(e + 16), readU32(e + 24), false};
+        if (c.fileOffset > file.size() || file.size() - c.fileOffset < c.packedSize) {
+            throw runtime_error("HMICB7 chunk " + to_string(i) + " runs past the end of the file");
+        }
+        if (!plausibleBlock(c.packedSize, c.rawSize)) {
+            throw runtime_error("HMICB7 chunk " + to_string(i) + " claims an impossible size");
+        }
+        // Chunks tile the .hmicb in order right after the header
+        if (c.rawOffset != rawSize) throw runtime_error("HMICB7 chunk " + to_string(i) + " is out of place");
+        rawSize += c.rawSize;
+        chunks.push_back(c);
+    }
+
+    raw.resize(rawSize);
+    memcpy(raw.data(), file.data() + tableEnd, headerSize);
+}
+
+void HMICBReader::loadIndex() {
+    if (raw.size() < 32 || memcmp(raw.data(), "HMICB", 5) != 0) throw runtime_error("bad HMICB header");
+    info.version = (uint8_t)raw[5];
+    if (info.version < 1 || info.version > 2) {
+        throw runtime_error("unsupported HMICB version " + to_string((int)info.version));
+    }
+    info.width = (int)readU16(raw.data() + 6);
+    info.height = (int)readU16(raw.data() + 8);
+    info.fps = (int)readU16(raw.data() + 10);
+    info.frameCount = readU32(raw.data() + 12);
+    info.loop = raw[16] == 1;
+    info.compression = (uint8_t)raw[17];
+
+    size_t indexEnd = 32 + (size_t)info.frameCount * 9;
+    if (raw.size() < indexEnd) throw runtime_error("HMICB frame index is cut off");
+
+    index.resize(info.frameCount);
+    for (size_t i = 0; i < index.size(); i++) {
+        const char* e = raw.data() + 32 + i * 9;
+        index[i] = {readU32(e), readU32(e + 4), (uint8_t)e[8]};
+        if ((size_t)index[i].offset + index[i].size > raw.size()) {
+            throw runtime_error("HMICB frame " + to_string(i) + " runs past the end of the file");
+        }
+    }
+}
+
+void HMICBReader::unpackChunk(size_t c) {
+    if (chunks[c].ready) return;
+    // Linked chunks may copy from the 64 KB before them, so those have to be there first:
+    // walk back to the last chunk that is, then unpack forward (a loop, files can have
+    // hundreds of thousands of chunks)
+    size_t first = c;
+    if (linked) {
+        while (first > 0 && !chunks[first - 1].ready) first--;
+    }
+
+    for (size_t i = first; i <= c; i++) {
+        Chunk& ch = chunks[i];
+        const char* src = file.data() + ch.fileOffset;
+        char* dst = raw.data() + ch.rawOffset;
+        int n;
+        if (linked) {
+            size_t dictSize = min<size_t>(LZ4_WINDOW, ch.rawOffset);
+            n = LZ4_decompress_safe_usingDict(src, dst, (int)ch.packedSize, (int)ch.rawSize,
+                                              dst - dictSize, (int)dictSize);
+        } else {
+            n = LZ4_decompress_safe(src, dst, (int)ch.packedSize, (int)ch.rawSize);
+        }
+        if (n < 0 || (uint32_t)n != ch.rawSize) {
+            throw runtime_error("HMICB7 chunk " + to_string(i) + " failed to unpack");
+        }
+        ch.ready = true;
+    }
+}
+
+const uint8_t* HMICBReader::frameBytes(size_t n) {
+    const HMICBFrameEntry& e = index[n];
+    if (!chunks.empty() && e.size > 0) {
+        // First chunk that ends after the frame starts, then on until the frame is covered
+        auto it = upper_bound(chunks.begin(), chunks.end(), e.offset,
+                              [](uint32_t off, const Chunk& c) { return off < c.rawOffset + c.rawSize; });
+        for (size_t c = it - chunks.begin(); c < chunks.size() && chunks[c].rawOffset < e.offset + e.size; c++) {
+            unpackChunk(c);
+        }
+    }
+    return (const uint8_t*)raw.data() + e.offset;
+}
+
+DecodedFrame HMICBReader::cached(size_t n) {
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->first == n) {
+            cache.splice(cache.begin(), cache, it);
+            return cache.front().second;
+        }
+    }
+    return nullptr;
+}
+
+void HMICBReader::remember(size_t n, DecodedFrame f) {
+    cache.emplace_front(n, std::move(f));
+    while (cache.size() > cacheSize) cache.pop_back();
+}
+
+void HMICBReader::setCacheSize(size_t frames) {
+    cacheSize = max<size_t>(1, frames);
+    while (cache.size() > cacheSize) cache.pop_back();
+}
+
+DecodedFrame HMICBReader::frame(size_t n) {
+    if (n >= index.size()) {
+        throw runtime_error("frame " + to_string(n) + " out of range (" + to_string(index.size()) + " frames)");
+    }
+    if (DecodedFrame hit = cached(n)) return hit;
+
+    // Walk back to something we can start from: a cached frame or a raw keyframe
+    size_t start = n;
+    DecodedFrame base;
+    for (;; start--) {
+        if (start != n && (base = cached(start))) break;
+        if (index[start].type == FRAME_RAW) break;
+        if (start == 0) throw runtime_error("frame " + to_string(n) + " has no keyframe before it");
+    }
+
+    size_t pixels = (size_t)info.width * info.height;
+    vector<RGBA> pixelsOut;
+    if (base) {
+        pixelsOut = *base;
+        start++;
+    } else {
+        const HMICBFrameEntry& e = index[start];
+        if (e.size != pixels * 4) throw runtime_error("keyframe " + to_string(start) + " has the wrong size");
+        pixelsOut.resize(pixels);
+        memcpy(pixelsOut.data(), frameBytes(start), e.size);
+        if (start != n) remember(start, make_shared<const vector<RGBA>>(pixelsOut));
+        start++;
+    }
+
+    for (size_t f = start; f <= n; f++) {
+        const HMICBFrameEntry& e = index[f];
+        const uint8_t* bytes = frameBytes(f);
+        if (e.type == FRAME_RAW) {
+            if (e.size != pixels * 4) throw runtime_error("keyframe " + to_string(f) + " has the wrong size");
+            memcpy(pixelsOut.data(), bytes, e.size);
+        } else {
+            applyDelta(e.type, bytes, e.size, info.width, info.height, pixelsOut.data());
+        }
+    }
+
+    DecodedFrame result = make_shared<const vector<RGBA>>(std::move(pixelsOut));
+    remember(n, result);
+    return result;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "hmicx.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace HMICX {
+
+    // 📼 HMICB / HMICB7 DECODER - the native twin of the HTML viewer
+    //
+    //   HMICBReader r = HMICBReader::open("anim.hmicb7");
+    //   auto first = r.frame(0);          // width*height RGBA, row major
+    //   auto last  = r.frame(r.frameCount() - 1);
+    //
+    // Reads .hmicb, single-block .hmicb7 and chunked .hmicb7 (told apart by content, not
+    // by extension). frame(n) seeks: it starts from the closest cached frame or the
+    // nearest raw keyframe at or before n and applies the deltas from there. Chunked
+    // files only unpack the chunks those frames live in. The last few decoded frames are
+    // kept, so playing forward costs one delta per frame.
+    // Not thread safe - use one reader per thread.
+
+    struct HMICBHeader {
+        uint8_t version = 0;
+        int width = 0, height = 0, fps = 0;
+        uint32_t frameCount = 0;
+        bool loop = false;
+        uint8_t compression = 0;
+    };
+
+    struct HMICBFrameEntry {
+        uint32_t offset, size;
+        uint8_t type;
+    };
+
+    using DecodedFrame = std::shared_ptr<const std::vector<RGBA>>;
+
+    class HMICBReader {
+    public:
+        static HMICBReader open(const std::string& path);
+        static HMICBReader fromBuffer(std::vector<char> bytes);
+
+        const HMICBHeader& header() const { return info; }
+        size_t frameCount() const { return index.size(); }
+        const HMICBFrameEntry& entry(size_t n) const { return index.at(n); }
+
+        // Throws runtime_error for n out of range or a damaged file
+        DecodedFrame frame(size_t n);
+
+        // How many decoded frames to keep around (at least 1)
+        void setCacheSize(size_t frames);
+
+    private:
+        struct Chunk {
+            uint32_t rawOffset, rawSize;
+            uint64_t fileOffset;
+            uint32_t packedSize;
+            bool ready;
+        };
+
+        std::vector<char> file;            // what we were given
+        std::vector<char> raw;             // the .hmicb (unpacked lazily when chunked)
+        std::vector<Chunk> chunks;         // empty unless chunked
+        bool linked = false;
+        HMICBHeader info;
+        std::vector<HMICBFrameEntry> index;
+        std::list<std::pair<size_t, DecodedFrame>> cache;   // most recent first
+        size_t cacheSize = 8;
+
+        explicit HMICBReader(std::vector<char> bytes);
+        void loadChunked();
+        void loadIndex();
+        void unpackChunk(size_t c);
+        const uint8_t* frameBytes(size_t n);
+        DecodedFrame cached(size_t n);
+        void remember(size_t n, DecodedFrame f);
+    };
+
+}  // namespace HMICX
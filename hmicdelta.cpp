@@ -0,0 +1,316 @@
+#include "hmicdelta.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace HMICX;
+
+namespace {
+
+    constexpr size_t RECORD = 8;   // x, y, rgba
+
+    uint32_t loadPixel(const RGBA* p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+
+    // Output that grows by doubling and is trimmed once at the end, so the hot loop
+    // writes through a plain pointer instead of push_back
+    struct DeltaWriter {
+        vector<uint8_t>& out;
+        size_t used = 4;
+        size_t changes = 0;
+        // Pixel position -> (x, y) without a division for every changed pixel
+        size_t width, rowStart = 0, rowEnd = 0;
+        uint32_t y = 0;
+
+        DeltaWriter(vector<uint8_t>& out_, size_t width_, size_t guess)
+            : out(out_), width(width_ ? width_ : 1) {
+            out.resize(4 + guess * RECORD);
+        }
+
+        void reserve(size_t records) {
+            size_t need = used + records * RECORD;
+            if (need > out.size()) out.resize(max(need, out.size() * 2));
+        }
+
+        // Caller made room with reserve()
+        void add(size_t i, const RGBA& c) {
+            if (i >= rowEnd) {
+                y = uint32_t(i / width);
+                rowStart = size_t(y) * width;
+                rowEnd = rowStart + width;
+            }
+            uint16_t x = uint16_t(i - rowStart);
+            uint8_t* d = out.data() + used;
+            d[0] = x & 0xFF;
+            d[1] = (x >> 8) & 0xFF;
+            d[2] = y & 0xFF;
+            d[3] = (y >> 8) & 0xFF;
+            d[4] = c.r;
+            d[5] = c.g;
+            d[6] = c.b;
+            d[7] = c.a;
+            used += RECORD;
+            changes++;
+        }
+
+        void finish() {
+            out.resize(used);
+            out[0] = (changes & 0xFF);
+            out[1] = ((changes >> 8) & 0xFF);
+            out[2] = ((changes >> 16) & 0xFF);
+            out[3] = ((changes >> 24) & 0xFF);
+        }
+    };
+
+    // Room for a frame where ~1/16 of the pixels changed before the first regrow
+    size_t initialGuess(size_t count) {
+        return count / 16 + 64;
+    }
+
+#if defined(__AVX2__)
+    constexpr size_t DIFF_BLOCK = 32;
+
+    // Bit k set = pixel base+k changed
+    uint32_t changedMask(const RGBA* prev, const RGBA* curr) {
+        uint32_t same = 0;
+        for (int v = 0; v < 4; v++) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + v * 8));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(curr + v * 8));
+            same |= uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))) << (v * 8);
+        }
+        return ~same;
+    }
+#elif defined(__SSE2__)
+    constexpr size_t DIFF_BLOCK = 16;
+
+    uint32_t changedMask(const RGBA* prev, const RGBA* curr) {
+        uint32_t same = 0;
+        for (int v = 0; v < 4; v++) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + v * 4));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(curr + v * 4));
+            same |= uint32_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)))) << (v * 4);
+        }
+        return ~same & 0xFFFFu;
+    }
+#endif
+
+    // Calls onChanged(i) for every pixel i where the frames differ, in order
+    template<class Fn>
+    void forEachChanged(const RGBA* prev, const RGBA* curr, size_t count, Fn onChanged) {
+        size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+        for (; i + DIFF_BLOCK <= count; i += DIFF_BLOCK) {
+            uint32_t mask = changedMask(prev + i, curr + i);
+            while (mask) {   // usually 0: nothing moved here
+                onChanged(i + (size_t)__builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            if (loadPixel(prev + i) != loadPixel(curr + i)) onChanged(i);
+        }
+    }
+
+    // Up to 256 distinct colors, insertion ordered, with an open-addressing lookup
+    struct SmallPalette {
+        static constexpr size_t SLOTS = 512;
+        uint32_t keys[SLOTS];
+        int16_t slots[SLOTS];
+        vector<uint32_t> colors;
+        bool full = false;   // more than 256 colors seen, gave up
+
+        SmallPalette() { fill_n(slots, SLOTS, int16_t(-1)); }
+
+        static size_t hash(uint32_t v) { return (v * 2654435761u) >> 23; }
+
+        void add(uint32_t v) {
+            if (full) return;
+            size_t h = hash(v);
+            while (slots[h] >= 0) {
+                if (keys[h] == v) return;
+                h = (h + 1) & (SLOTS - 1);
+            }
+            if (colors.size() == 256) { full = true; return; }
+            keys[h] = v;
+            slots[h] = (int16_t)colors.size();
+            colors.push_back(v);
+        }
+
+        uint8_t indexOf(uint32_t v) const {
+            size_t h = hash(v);
+            while (slots[h] < 0 || keys[h] != v) h = (h + 1) & (SLOTS - 1);
+            return (uint8_t)slots[h];
+        }
+    };
+
+    // Little endian, no matter what the host is
+    void putU16(vector<uint8_t>& out, uint16_t v) {
+        out.push_back(v & 0xFF);
+        out.push_back((v >> 8) & 0xFF);
+    }
+
+    void putU32(vector<uint8_t>& out, uint32_t v) {
+        for (int k = 0; k < 4; k++) out.push_back((v >> (8 * k)) & 0xFF);
+    }
+
+    // Bounds-checked little endian reads for the decoder
+    struct DeltaReader {
+        const uint8_t* data;
+        size_t size, pos = 0;
+
+        void need(size_t n) const {
+            if (size - pos < n) throw runtime_error("delta frame is truncated");
+        }
+        uint32_t u16() { need(2); uint32_t v = data[pos] | (data[pos + 1] << 8); pos += 2; return v; }
+        uint32_t u32() {
+            need(4);
+            uint32_t v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+            pos += 4;
+            return v;
+        }
+        uint64_t varint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                need(1);
+                uint8_t b = data[pos++];
+                v |= uint64_t(b & 0x7F) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            throw runtime_error("delta frame has a broken varint");
+        }
+    };
+
+    void putVarint(vector<uint8_t>& out, size_t v) {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+}  // namespace
+
+void HMICX::encodeDeltaScalar(const RGBA* prev, const RGBA* curr, size_t count, int width,
+                              vector<uint8_t>& out) {
+    DeltaWriter w(out, (size_t)width, initialGuess(count));
+    for (size_t i = 0; i < count; i++) {
+        if (loadPixel(prev + i) != loadPixel(curr + i)) {
+            w.reserve(1);
+            w.add(i, curr[i]);
+        }
+    }
+    w.finish();
+}
+
+void HMICX::encodeDelta(const RGBA* prev, const RGBA* curr, size_t count, int width,
+                        vector<uint8_t>& out) {
+    DeltaWriter w(out, (size_t)width, initialGuess(count));
+    forEachChanged(prev, curr, count, [&](size_t i) {
+        w.reserve(1);
+        w.add(i, curr[i]);
+    });
+    w.finish();
+}
+
+void HMICX::encodeDeltaRuns(const RGBA* prev, const RGBA* curr, size_t count,
+                            vector<uint8_t>& out) {
+    // 1️⃣ Runs of changed pixels, and their colors while we're at it
+    vector<pair<size_t, size_t>> runs;   // start, length
+    SmallPalette palette;
+    size_t changed = 0;
+    forEachChanged(prev, curr, count, [&](size_t i) {
+        if (!runs.empty() && runs.back().first + runs.back().second == i) runs.back().second++;
+        else runs.push_back({i, 1});
+        palette.add(loadPixel(curr + i));
+        changed++;
+    });
+    
+    // 2️⃣ Indices only pay off if the palette costs less than the 3 bytes/pixel they save
+    bool indexed = !palette.full && palette.colors.size() * 4 < changed * 3;
+    size_t pixelBytes = indexed ? 1 : 4;
+    
+    out.clear();
+    out.reserve(6 + (indexed ? palette.colors.size() * 4 : 0) + runs.size() * 4 + changed * pixelBytes);
+    putU32(out, (uint32_t)runs.size());
+    putU16(out, indexed ? (uint16_t)palette.colors.size() : 0);
+    if (indexed) {
+        for (uint32_t c : palette.colors) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&c);   // r g b a, as loaded
+            out.insert(out.end(), bytes, bytes + 4);
+        }
+    }
+    
+    size_t pos = 0;
+    for (const auto& run : runs) {
+        putVarint(out, run.first - pos);
+        putVarint(out, run.second);
+        const RGBA* px = curr + run.first;
+        if (indexed) {
+            for (size_t k = 0; k < run.second; k++) out.push_back(palette.indexOf(loadPixel(px + k)));
+        } else {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(px);
+            out.insert(out.end(), bytes, bytes + run.second * 4);
+        }
+        pos = run.first + run.second;
+    }
+}
+
+void HMICX::applyDelta(uint8_t type, const uint8_t* data, size_t size, int width, int height,
+                       RGBA* frame) {
+    DeltaReader in{data, size};
+    uint64_t count = (uint64_t)max(width, 0) * (uint64_t)max(height, 0);
+    
+    if (type == FRAME_DELTA) {
+        uint32_t changes = in.u32();
+        in.need((size_t)changes * 8);
+        for (uint32_t k = 0; k < changes; k++) {
+            uint32_t x = in.u16(), y = in.u16();
+            if (x >= (uint32_t)width || y >= (uint32_t)height) {
+                throw runtime_error("delta pixel " + to_string(x) + "x" + to_string(y) + " is outside the frame");
+            }
+            memcpy(&frame[(size_t)y * width + x], data + in.pos, 4);
+            in.pos += 4;
+        }
+    } else if (type == FRAME_DELTA_RUNS) {
+        uint32_t runs = in.u32();
+        uint32_t paletteSize = in.u16();
+        if (paletteSize > 256) throw runtime_error("delta palette has more than 256 colors");
+        in.need((size_t)paletteSize * 4);
+        const uint8_t* palette = data + in.pos;
+        in.pos += (size_t)paletteSize * 4;
+        
+        uint64_t pos = 0;
+        for (uint32_t r = 0; r < runs; r++) {
+            pos += in.varint();
+            uint64_t length = in.varint();
+            if (pos > count || length > count - pos) throw runtime_error("delta run goes past the end of the frame");
+            if (paletteSize > 0) {
+                in.need((size_t)length);
+                for (uint64_t k = 0; k < length; k++) {
+                    uint8_t idx = data[in.pos++];
+                    if (idx >= paletteSize) throw runtime_error("delta palette index out of range");
+                    memcpy(&frame[pos + k], palette + idx * 4, 4);
+                }
+            } else {
+                in.need((size_t)length * 4);
+                memcpy(&frame[pos], data + in.pos, (size_t)length * 4);
+                in.pos += (size_t)length * 4;
+            }
+            pos += length;
+        }
+    } else {
+        throw runtime_error("unknown frame type " + to_string(type));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "hmicx.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HMICX {
+
+    // HMICB frame index `type` byte
+    enum FrameType : uint8_t {
+        FRAME_RAW = 0,          // width*height RGBA
+        FRAME_DELTA = 1,        // per-pixel delta, see encodeDelta
+        FRAME_DELTA_RUNS = 2,   // run-length delta, see encodeDeltaRuns (file version 2)
+    };
+
+    // 🔀 DELTA KERNELS - what changed between two frames
+    //
+    // Writes a type 1 (delta) frame body into `out`: u32 change count, then for every
+    // pixel of `curr` that differs from `prev`, in pixel order: x u16, y u16, r g b a
+    // (little endian, x = i % width, y = i / width). `count` pixels in both frames.
+    // encodeDelta is one pass - SSE2 (AVX2 with -mavx2) compares blocks of pixels into
+    // a changed-bitmask and only visits the set bits - and gives the same bytes as
+    // encodeDeltaScalar, the plain per-pixel reference
+    void encodeDelta(const RGBA* prev, const RGBA* curr, size_t count, int width,
+                     std::vector<uint8_t>& out);
+    void encodeDeltaScalar(const RGBA* prev, const RGBA* curr, size_t count, int width,
+                           std::vector<uint8_t>& out);
+
+    // Writes a type 2 (run) delta frame body into `out`:
+    //   u32 run count
+    //   u16 palette size - 0 = pixels are raw r g b a, 1..256 = that many r g b a
+    //       entries follow and pixels are one byte indices into them
+    //   per run: varint skip (unchanged pixels since the end of the last run, the first
+    //       run counts from pixel 0), varint length, then `length` changed pixels
+    // Varints are LEB128 (7 bits per byte, low bits first, high bit = more follows).
+    // Pixels are in row-major order, so a run can wrap onto the next row. The palette
+    // is used when the changed pixels have at most 256 colors and it makes the frame
+    // smaller
+    void encodeDeltaRuns(const RGBA* prev, const RGBA* curr, size_t count,
+                         std::vector<uint8_t>& out);
+
+    // The other way round: applies a type 1 or type 2 delta body to `frame` (width*height
+    // pixels, holding the previous frame). Throws runtime_error on anything malformed -
+    // truncated data, pixels outside the frame, palette indices past the palette - and
+    // on types it doesn't know, so a bad file never writes out of bounds
+    void applyDelta(uint8_t type, const uint8_t* data, size_t size, int width, int height,
+                    RGBA* frame);
+
+}  // namespace HMICX
@@ -0,0 +1,48 @@
+#pragma once
+#include <iostream>
+
+// 📢 COMPILE-TIME LOGGING - RELEASE BUILDS PAY NOTHING 📢
+//
+// Pick the level when compiling:
+//   -DHMICX_LOG_LEVEL=0   Off      no log output at all
+//   -DHMICX_LOG_LEVEL=1   Summary  one structured "[SUMMARY] stage=... key=value" line per stage
+//   -DHMICX_LOG_LEVEL=2   Debug    the full [DEBUG] chatter (per block, per frame, previews)
+//
+// Default is Summary when NDEBUG is set, Debug otherwise.
+// Disabled levels sit behind `if constexpr`, so the streaming code is still
+// type-checked but never emitted - no formatting, no flushes, no I/O.
+
+#ifndef HMICX_LOG_LEVEL
+#  ifdef NDEBUG
+#    define HMICX_LOG_LEVEL 1
+#  else
+#    define HMICX_LOG_LEVEL 2
+#  endif
+#endif
+
+namespace HMICX {
+namespace Log {
+
+    enum Level : int {
+        Off = 0,
+        Summary = 1,
+        Debug = 2
+    };
+
+    inline constexpr int level = HMICX_LOG_LEVEL;
+
+    template <int L>
+    inline constexpr bool enabled = (level >= L);
+
+}  // namespace Log
+}  // namespace HMICX
+
+// Usage: HMICX_DEBUG("[DEBUG] found " << n << " things\n");
+// No endl on purpose - we never flush from a hot path
+#define HMICX_DEBUG(...) \
+    do { if constexpr (HMICX::Log::enabled<HMICX::Log::Debug>) { std::cout << __VA_ARGS__; } } while (0)
+
+// Usage: HMICX_SUMMARY("parse", "frames=" << f << " commands=" << c);
+#define HMICX_SUMMARY(stage, ...) \
+    do { if constexpr (HMICX::Log::enabled<HMICX::Log::Summary>) { \
+        std::cout << "[SUMMARY] stage=" << stage << ' ' << __VA_ARGS__ << '\n'; } } while (0)
@@ -0,0 +1,202 @@
+#include "hmicmetrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2   // GetProcessMemoryInfo from kernel32, no psapi.lib
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace HMICX;
+
+// 🧮 Allocation counters: every operator new in the program goes through here.
+// Process-wide totals for processUsage(), per-thread ones for threadUsage()
+namespace {
+    atomic<uint64_t> allocCount{0};
+    atomic<uint64_t> allocTotal{0};
+    thread_local uint64_t threadAllocCount = 0;
+    thread_local uint64_t threadAllocTotal = 0;
+}
+
+void* operator new(size_t size) {
+    allocCount.fetch_add(1, memory_order_relaxed);
+    allocTotal.fetch_add(size, memory_order_relaxed);
+    threadAllocCount++;
+    threadAllocTotal += size;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+// Kept out of line, so GCC doesn't pair std::allocator's new with our free()
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { free(p); }
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+    double wallNow() {
+        return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+#ifdef _WIN32
+    double fileTimeSeconds(const FILETIME& t) {
+        return ((uint64_t)t.dwHighDateTime << 32 | t.dwLowDateTime) * 1e-7;   // 100 ns ticks
+    }
+#else
+    double clockSeconds(clockid_t id) {
+        timespec ts;
+        if (clock_gettime(id, &ts) != 0) return 0;
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+#endif
+
+    void number(ostringstream& out, double v) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.6f", v);
+        out<<buf;
+    }
+
+    void text(ostringstream& out, const string& s) {
+        out<<'"';
+        for (unsigned char c : s) {
+            if (c == '"' || c == '\\') out<<'\\'<<c;
+            else if (c == '\n') out<<"\\n";
+            else if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out<<buf;
+            }
+            else out<<c;   // UTF-8 goes through as is
+        }
+        out<<'"';
+    }
+
+    void usage(ostringstream& out, const Usage& u) {
+        out<<"\"wall_s\":";
+        number(out, u.wall);
+        out<<",\"cpu_s\":";
+        number(out, u.cpu);
+        out<<",\"allocs\":"<<u.allocs<<",\"alloc_bytes\":"<<u.allocBytes;
+    }
+
+    mutex appendMutex;
+
+}  // namespace
+
+Usage HMICX::processUsage() {
+    Usage u;
+    u.wall = wallNow();
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        u.cpu = fileTimeSeconds(kernel) + fileTimeSeconds(user);
+    }
+#else
+    u.cpu = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+#endif
+    u.allocs = allocCount.load(memory_order_relaxed);
+    u.allocBytes = allocTotal.load(memory_order_relaxed);
+    return u;
+}
+
+Usage HMICX::threadUsage() {
+    Usage u;
+    u.wall = wallNow();
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+        u.cpu = fileTimeSeconds(kernel) + fileTimeSeconds(user);
+    }
+#else
+    u.cpu = clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+#endif
+    u.allocs = threadAllocCount;
+    u.allocBytes = threadAllocTotal;
+    return u;
+}
+
+uint64_t HMICX::peakMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#  ifdef __APPLE__
+    return (uint64_t)ru.ru_maxrss;          // bytes on macOS
+#  else
+    return (uint64_t)ru.ru_maxrss * 1024;   // KB everywhere else
+#  endif
+#endif
+}
+
+StageMetrics& ConversionMetrics::add(const string& stage, const Usage& cost) {
+    StageMetrics s;
+    s.stage = stage;
+    s.cost = cost;
+    s.peakMemory = HMICX::peakMemory();
+    stages.push_back(s);
+    return stages.back();
+}
+
+string ConversionMetrics::toJson() const {
+    ostringstream out;
+    out<<"{\"input\":";
+    text(out, input);
+    out<<",\"ok\":"<<(error.empty() ? "true" : "false");
+    if (!error.empty()) {
+        out<<",\"error\":";
+        text(out, error);
+    }
+    out<<",\"width\":"<<width<<",\"height\":"<<height<<",\"frames\":"<<frames<<",";
+    usage(out, total);
+    if (ownsProcess) out<<",\"peak_memory_bytes\":"<<HMICX::peakMemory();
+    out<<",\"stages\":[";
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageMetrics& s = stages[i];
+        if (i) out<<',';
+        out<<"{\"stage\":";
+        text(out, s.stage);
+        out<<',';
+        usage(out, s.cost);
+        out<<",\"bytes_in\":"<<s.bytesIn<<",\"bytes_out\":"<<s.bytesOut<<",\"pixels\":"<<s.pixels;
+        if (ownsProcess) out<<",\"peak_memory_bytes\":"<<s.peakMemory;
+        out<<'}';
+    }
+    out<<"]}";
+    return out.str();
+}
+
+void HMICX::appendMetrics(const string& path, const string& line) {
+    lock_guard<mutex> lock(appendMutex);
+    if (path == "-") {
+        cout<<line<<'\n';
+        return;
+    }
+    ofstream out(path, ios::app);
+    if (!out) throw runtime_error("cannot open metrics file " + path);
+    out<<line<<'\n';
+    out.close();
+    if (!out) throw runtime_error("failed writing metrics file " + path);
+}
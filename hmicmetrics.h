@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HMICX {
+
+    // 📈 CONVERSION METRICS - what every stage cost, as JSON
+    //
+    //   Usage t0 = processUsage();
+    //   parse();
+    //   metrics.add("parse", processUsage() - t0).bytesIn = textSize;
+    //   appendMetrics("metrics.jsonl", metrics.toJson());
+    //
+    // Usage is a reading of the clocks and the allocation counters; the difference of two
+    // readings is what happened in between. processUsage() counts the whole process (use it
+    // for stages that run alone), threadUsage() only the calling thread (for stages that
+    // interleave with others on different threads, like render and write). Allocations are
+    // every operator new, counted by hmicmetrics.cpp for any program that links it.
+
+    struct Usage {
+        double wall = 0;          // seconds, steady clock
+        double cpu = 0;           // seconds of CPU (process or thread, see above)
+        uint64_t allocs = 0;      // operator new calls
+        uint64_t allocBytes = 0;  // bytes asked for by them
+    };
+
+    inline Usage operator-(Usage a, const Usage& b) {
+        a.wall -= b.wall;
+        a.cpu -= b.cpu;
+        a.allocs -= b.allocs;
+        a.allocBytes -= b.allocBytes;
+        return a;
+    }
+
+    inline Usage& operator+=(Usage& a, const Usage& b) {
+        a.wall += b.wall;
+        a.cpu += b.cpu;
+        a.allocs += b.allocs;
+        a.allocBytes += b.allocBytes;
+        return a;
+    }
+
+    Usage processUsage();
+    Usage threadUsage();
+    // High-water mark of the process' resident memory so far, in bytes (0 = unknown here)
+    uint64_t peakMemory();
+
+    struct StageMetrics {
+        std::string stage;
+        Usage cost;
+        uint64_t bytesIn = 0, bytesOut = 0;
+        uint64_t pixels = 0;
+        uint64_t peakMemory = 0;   // process high-water mark when the stage was done
+    };
+
+    // One conversion: the stages in the order they ran, plus the whole thing
+    struct ConversionMetrics {
+        std::string input;
+        std::string error;         // empty = it worked
+        int width = 0, height = 0, frames = 0;
+        Usage total;
+        // false = other conversions share the process (batch -j > 1), so its peak memory
+        // isn't this one's and peak_memory_bytes is left out
+        bool ownsProcess = true;
+        std::vector<StageMetrics> stages;
+
+        // Records a stage with peakMemory taken right now
+        StageMetrics& add(const std::string& stage, const Usage& cost);
+        // A single line of JSON (JSON Lines, so files can just be appended to)
+        std::string toJson() const;
+    };
+
+    // Appends a line to `path`, or writes it to stdout for "-". Safe to call from
+    // several threads at once; throws runtime_error if the file can't be written
+    void appendMetrics(const std::string& path, const std::string& line);
+
+}  // namespace HMICX
@@ -0,0 +1,588 @@
+#include "hmicx.h"
+#include "hmicblend.h"
+#include "hmicbenc.h"
+#include "hmicbreader.h"
+#include "hmicdelta.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace HMICX;
+
+// 🧪 HMICB SELF-TEST 🧪
+// Randomized checks that every fast path gives exactly what its plain reference gives.
+// Build it once as is and once with -mavx2 so both SIMD widths get compared.
+//
+//   hmictest            default seed
+//   hmictest 42         another seed (printed with every failure, so it can be replayed)
+//
+// Exit code 1 if anything differs.
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    if (ok) return;
+    failures++;
+    if (failures <= 20) cout<<"❌ "<<what<<"\n";
+}
+
+using Rng = mt19937;
+
+static int pick(Rng& rng, int lo, int hi) {
+    return uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+static bool chance(Rng& rng, double p) {
+    return uniform_real_distribution<double>(0, 1)(rng) < p;
+}
+
+static bool samePixels(const vector<Pixel>& a, const vector<Pixel>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+    }
+    return true;
+}
+
+// Points and runs of a SpanCommand back as single pixels, in the order emitLine makes them
+static vector<Pixel> expand(const SpanCommand& s) {
+    vector<Pixel> out = s.points;
+    for (const Run& r : s.rows) {
+        for (int k = 0; k < r.length; k++) out.push_back({r.x + k, r.y});
+    }
+    for (const Run& r : s.columns) {
+        for (int k = 0; k < r.length; k++) out.push_back({r.x, r.y + k});
+    }
+    return out;
+}
+
+// 🔢 P= / PL= lines: canonical ones (the fast path), and everything that has to fall back
+// - spaces, upper case, long payloads, long numbers, junk
+static string randomNumber(Rng& rng, bool allowLong) {
+    int digits = allowLong && chance(rng, 0.1) ? pick(rng, 5, 9) : pick(rng, 1, 4);
+    string n;
+    for (int i = 0; i < digits; i++) n += char('0' + pick(rng, i == 0 && digits > 1 ? 1 : 0, 9));
+    return n;
+}
+
+static string randomPixelLine(Rng& rng) {
+    auto coord = [&](bool allowLong) {
+        return randomNumber(rng, allowLong) + (chance(rng, 0.1) ? "X" : "x") + randomNumber(rng, allowLong);
+    };
+    string line;
+    if (chance(rng, 0.5)) {
+        line = chance(rng, 0.2) ? "p=" : "P=";
+        int points = chance(rng, 0.2) ? pick(rng, 10, 40) : pick(rng, 1, 8);   // > 64 bytes sometimes
+        for (int i = 0; i < points; i++) {
+            if (i) line += chance(rng, 0.05) ? ", " : ",";
+            line += coord(true);
+        }
+    } else {
+        line = chance(rng, 0.2) ? "pl=" : "PL=";
+        int x = pick(rng, 0, 2000), y = pick(rng, 0, 2000), len = pick(rng, 0, 300);
+        int kind = pick(rng, 0, 2);   // horizontal, vertical, diagonal (ignored)
+        int x2 = (kind == 1) ? x : x + (chance(rng, 0.5) ? len : -min(len, x));
+        int y2 = (kind == 0) ? y : y + (chance(rng, 0.5) ? len : -min(len, y));
+        line += to_string(x) + "x" + to_string(y) + "-" + to_string(x2) + "x" + to_string(y2);
+    }
+    if (chance(rng, 0.1)) line = string(pick(rng, 1, 3), ' ') + line;
+    if (chance(rng, 0.1)) line += string(pick(rng, 1, 3), chance(rng, 0.5) ? ' ' : '\t');
+    if (chance(rng, 0.05)) line[pick(rng, 0, (int)line.size() - 1)] = "#;x-, a"[pick(rng, 0, 6)];
+    if (chance(rng, 0.02)) line = chance(rng, 0.5) ? "" : "Q=1x1";
+    return line;
+}
+
+static void testPixelLines(Rng& rng, int rounds) {
+    for (int i = 0; i < rounds; i++) {
+        string line = randomPixelLine(rng);
+        vector<Pixel> reference, fast, inPlace;
+        parsePixelLineScalar(line.data(), line.size(), reference);
+        parsePixelLine(line.data(), line.size(), fast);
+        // Same line with plenty readable after it, so the loads run in place
+        string padded = line + string(128, '\n');
+        parsePixelLine(padded.data(), line.size(), inPlace, padded.data() + padded.size());
+        check(samePixels(reference, fast), "parsePixelLine '" + line + "'");
+        check(samePixels(reference, inPlace), "parsePixelLine in place '" + line + "'");
+
+        SpanCommand spans;
+        parsePixelLine(line.data(), line.size(), spans);
+        check(samePixels(reference, expand(spans)), "parsePixelLine spans '" + line + "'");
+    }
+}
+
+// 📄 Whole .hmic documents: overlapping and nested F-ranges, colors with and without
+// alpha (repeated, so the palette has to dedupe), stray braces and junk, LF or CRLF,
+// and sometimes cut off anywhere
+static string randomDocument(Rng& rng) {
+    static const char* const colors[] = {
+        "rgba(255,0,0,255)", "rgba(0,0,255,128)", "rgba(10,20,30,0)", "RGBA(1,2,3,200)",
+        "rgb(0,255,0)", "rgb(9, 9, 9)", "#ff8800", "#A0b0C0",
+    };
+    string nl = chance(rng, 0.5) ? "\r\n" : "\n";
+    int frames = pick(rng, 1, 60);
+    string doc;
+    if (chance(rng, 0.9)) {
+        doc += "info{" + nl + "DISPLAY=" + to_string(pick(rng, 1, 64)) + "X" + to_string(pick(rng, 1, 64)) + nl
+             + "FPS=" + to_string(pick(rng, 1, 60)) + nl + "F=" + to_string(frames) + nl
+             + "LOOP=" + (chance(rng, 0.5) ? "Y" : "N") + nl + "}" + nl + nl;
+    }
+
+    int outerStart = 1, outerEnd = frames;
+    for (int b = pick(rng, 0, 12); b > 0; b--) {
+        // Mostly ranges inside the previous one (F1-60, F1-40, F5-20, ...), sometimes a fresh one
+        int lo = chance(rng, 0.7) ? outerStart : 1, hi = chance(rng, 0.7) ? outerEnd : frames;
+        int start = pick(rng, lo, hi), end = pick(rng, start, hi);
+        if (chance(rng, 0.05)) end = frames + pick(rng, 1, 5);   // past the last frame
+        outerStart = start;
+        outerEnd = max(start, min(end, frames));
+
+        doc += chance(rng, 0.1) ? "f" : "F";
+        doc += to_string(start);
+        if (start != end || chance(rng, 0.5)) doc += "-" + to_string(end);
+        doc += string(chance(rng, 0.2) ? 1 : 0, ' ') + "{" + nl;
+        for (int c = pick(rng, 0, 4); c > 0; c--) {
+            if (chance(rng, 0.05)) doc += "  {junk}" + nl;
+            doc += string("  ") + colors[pick(rng, 0, 7)] + (chance(rng, 0.2) ? " {" : "{") + nl;
+            for (int l = pick(rng, 0, 5); l > 0; l--) doc += "    " + randomPixelLine(rng) + nl;
+            doc += "  }" + nl;
+        }
+        doc += "}" + nl;
+    }
+    if (chance(rng, 0.2)) doc.resize((size_t)pick(rng, 0, (int)doc.size()));
+    return doc;
+}
+
+static bool sameCommand(const Command& a, const Command& b) {
+    return a.start == b.start && a.end == b.end && a.color == b.color && a.colorIndex == b.colorIndex
+        && samePixels(a.pixels, b.pixels);
+}
+
+static bool sameCommands(const vector<Command>& a, const vector<Command>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!sameCommand(a[i], b[i])) return false;
+    }
+    return true;
+}
+
+static bool samePalette(const Palette& a, const Palette& b) {
+    if (a.size() != b.size()) return false;
+    for (uint32_t i = 0; i < a.size(); i++) {
+        if (a.name(i) != b.name(i) || memcmp(&a[i], &b[i], sizeof(RGBA)) != 0) return false;
+    }
+    return true;
+}
+
+static bool sameRuns(const Run* a, size_t count, const vector<Run>& b) {
+    if (count != b.size()) return false;
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].length != b[i].length) return false;
+    }
+    return true;
+}
+
+static vector<Pixel> sorted(vector<Pixel> pixels) {
+    sort(pixels.begin(), pixels.end(), [](const Pixel& a, const Pixel& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+    return pixels;
+}
+
+// Span form vs the reference Command: same frames and color, same pixels once expanded
+// (grouped into points, rows and columns, so in another order - one color, same result)
+static bool sameSpans(const vector<Command>& reference, const vector<SpanCommand>& spans) {
+    if (reference.size() != spans.size()) return false;
+    for (size_t i = 0; i < spans.size(); i++) {
+        const Command& c = reference[i];
+        const SpanCommand& s = spans[i];
+        if (c.start != s.start || c.end != s.end || c.color != s.color || c.colorIndex != s.colorIndex
+            || !samePixels(sorted(c.pixels), sorted(expand(s)))) return false;
+    }
+    return true;
+}
+
+// Arena form vs span form: the same points and runs, just pooled
+static bool sameArena(const vector<SpanCommand>& spans, const CommandArena& arena) {
+    if (spans.size() != arena.commands.size()) return false;
+    for (size_t i = 0; i < spans.size(); i++) {
+        const SpanCommand& s = spans[i];
+        const ArenaCommand& a = arena.commands[i];
+        vector<Pixel> points(arena.pointsOf(a), arena.pointsOf(a) + a.pointsCount);
+        if (s.start != a.start || s.end != a.end || s.colorIndex != a.colorIndex
+            || !samePixels(s.points, points) || !sameRuns(arena.rowsOf(a), a.rowsCount, s.rows)
+            || !sameRuns(arena.columnsOf(a), a.columnsCount, s.columns)) return false;
+    }
+    return true;
+}
+
+// 🧵 Parse modes: parse() on N threads (parseFramesParallel) vs the serial parse, and
+// parseSpans / parseArena (what the converter uses) on 1 and N threads vs parse(1)
+static void testParseModes(Rng& rng, int documents) {
+    for (int d = 0; d < documents; d++) {
+        string doc = randomDocument(rng);
+        unsigned threads = (unsigned)pick(rng, 2, 8);
+        string what = "document " + to_string(d) + " (" + to_string(doc.size()) + " bytes)";
+
+        Parser serial = Parser::fromBuffer(doc);
+        serial.parse(1);
+        Parser parallel = Parser::fromBuffer(doc);
+        parallel.parse(threads);
+        check(sameCommands(serial.getCommands(), parallel.getCommands()),
+              what + ": parse(" + to_string(threads) + ") commands");
+        check(samePalette(serial.getPalette(), parallel.getPalette()),
+              what + ": parse(" + to_string(threads) + ") palette");
+
+        for (unsigned t : {1u, threads}) {
+            string mode = "(" + to_string(t) + ")";
+            Parser spans = Parser::fromBuffer(doc);
+            spans.parseSpans(t);
+            check(sameSpans(serial.getCommands(), spans.getSpanCommands()), what + ": parseSpans" + mode + " commands");
+            check(samePalette(serial.getPalette(), spans.getPalette()), what + ": parseSpans" + mode + " palette");
+
+            Parser arena = Parser::fromBuffer(doc);
+            arena.parseArena(t);
+            check(sameArena(spans.getSpanCommands(), arena.getArena()), what + ": parseArena" + mode + " commands");
+            check(samePalette(serial.getPalette(), arena.getPalette()), what + ": parseArena" + mode + " palette");
+        }
+    }
+}
+
+// Some of the places a chunk boundary hurts most: inside info{, inside a color token,
+// between CR and LF. Positions are strictly inside the document
+static vector<size_t> awkwardCuts(Rng& rng, const string& doc) {
+    vector<size_t> cuts;
+    auto near = [&](const string& token, size_t within) {
+        size_t at = doc.find(token, (size_t)pick(rng, 0, (int)doc.size()));
+        if (at == string::npos) at = doc.find(token);
+        if (at != string::npos) cuts.push_back(at + (size_t)pick(rng, 1, (int)within));
+    };
+    near("info{", 4);
+    near("rgba(", 12);
+    near("rgb(", 8);
+    near("#", 6);
+    near("\r\n", 1);
+    near("\r\n", 1);
+    cuts.erase(remove_if(cuts.begin(), cuts.end(), [&](size_t c) { return c == 0 || c >= doc.size(); }),
+               cuts.end());
+    return cuts;
+}
+
+// 🌊 StreamParser fed the document in random pieces (single bytes, awkward cuts, big
+// chunks) hands out exactly the commands, palette and header of Parser::parse
+static void testStreamParser(Rng& rng, int documents) {
+    for (int d = 0; d < documents; d++) {
+        string doc = randomDocument(rng);
+        string what = "stream document " + to_string(d) + " (" + to_string(doc.size()) + " bytes)";
+
+        Parser whole = Parser::fromBuffer(doc);
+        whole.parse(1);
+
+        vector<size_t> cuts = awkwardCuts(rng, doc);
+        int style = pick(rng, 0, 2);   // byte by byte, small pieces, a few big ones
+        int extra = style == 0 ? (int)doc.size() : style == 1 ? (int)doc.size() / 4 : 3;
+        for (int k = 0; k < extra && doc.size() > 1; k++) cuts.push_back((size_t)pick(rng, 1, (int)doc.size() - 1));
+        cuts.push_back(0);
+        cuts.push_back(doc.size());
+        sort(cuts.begin(), cuts.end());
+        cuts.erase(unique(cuts.begin(), cuts.end()), cuts.end());
+
+        vector<Command> streamed;
+        StreamParser sp([&](Command&& c) { streamed.push_back(std::move(c)); });
+        for (size_t k = 0; k + 1 < cuts.size(); k++) sp.feed(doc.data() + cuts[k], cuts[k + 1] - cuts[k]);
+        sp.finish();
+
+        check(sameCommands(whole.getCommands(), streamed), what + ": commands");
+        check(samePalette(whole.getPalette(), sp.getPalette()), what + ": palette");
+        check(whole.getHeader() == sp.getHeader(), what + ": header");
+    }
+}
+
+static RGBA randomColor(Rng& rng) {
+    return {(uint8_t)pick(rng, 0, 255), (uint8_t)pick(rng, 0, 255), (uint8_t)pick(rng, 0, 255), (uint8_t)pick(rng, 0, 255)};
+}
+
+static bool sameColors(const RGBA* a, const RGBA* b, size_t count) {
+    return memcmp(a, b, count * sizeof(RGBA)) == 0;
+}
+
+// 🖌️ Blend kernels: blendSpan vs blendSpanScalar on rows and columns of every length
+// around the vector widths, at odd offsets, and blendSpanScalar vs the one-pixel formulas
+static void testBlend(Rng& rng, int rounds) {
+    for (int i = 0; i < rounds; i++) {
+        BlendMode mode = chance(rng, 0.5) ? BlendMode::Over : BlendMode::Classic;
+        RGBA color = randomColor(rng);
+        if (chance(rng, 0.1)) color.a = 0;
+        if (chance(rng, 0.1)) color.a = 255;
+        size_t count = (size_t)pick(rng, 0, chance(rng, 0.8) ? 40 : 300);
+        size_t step = chance(rng, 0.7) ? 1 : (size_t)pick(rng, 2, 9);
+        size_t offset = (size_t)pick(rng, 0, 7);
+
+        vector<RGBA> before(offset + count * step + 8);
+        for (RGBA& p : before) {
+            p = randomColor(rng);
+            if (chance(rng, 0.1)) p.a = chance(rng, 0.5) ? 0 : 255;
+        }
+        vector<RGBA> reference = before, fast = before;
+        blendSpanScalar(reference.data() + offset, count, step, color, mode);
+        blendSpan(fast.data() + offset, count, step, color, mode);
+        string what = string(mode == BlendMode::Over ? "over" : "classic") + " blendSpan count " + to_string(count)
+                    + " step " + to_string(step) + " alpha " + to_string(color.a);
+        check(sameColors(reference.data(), fast.data(), reference.size()), what);
+
+        // The scalar span is the one-pixel formula on exactly the pixels it covers
+        vector<RGBA> expected = before;
+        for (size_t k = 0; k < count; k++) {
+            RGBA& p = expected[offset + k * step];
+            p = (mode == BlendMode::Over) ? blendOver(p, color) : blendClassic(p, color);
+        }
+        check(sameColors(expected.data(), reference.data(), expected.size()), what + " (scalar vs formula)");
+    }
+}
+
+// Next frame of a random animation: mostly small changes, sometimes a scene cut
+static Frame nextFrame(Rng& rng, const Frame& prev, int width) {
+    Frame f = prev;
+    int kind = pick(rng, 0, 9);
+    if (kind == 0) {
+        for (RGBA& p : f) p = randomColor(rng);           // scene cut
+    } else if (kind == 1) {
+        // nothing changes
+    } else {
+        int changes = pick(rng, 1, max(1, (int)f.size() / (kind == 2 ? 2 : 20)));
+        for (int c = 0; c < changes; c++) {
+            size_t at = (size_t)pick(rng, 0, (int)f.size() - 1);
+            size_t run = min(f.size() - at, (size_t)pick(rng, 1, width));
+            RGBA color = randomColor(rng);
+            bool solid = chance(rng, 0.5);
+            for (size_t k = 0; k < run; k++) f[at + k] = solid ? color : randomColor(rng);
+        }
+    }
+    return f;
+}
+
+// 🔀 Delta coder: encodeDelta vs encodeDeltaScalar on frames with every kind of change
+// pattern and sizes that don't fill the last vector block
+static void testDelta(Rng& rng, int rounds) {
+    for (int i = 0; i < rounds; i++) {
+        int width = pick(rng, 1, 70), height = pick(rng, 1, 20);
+        Frame prev((size_t)width * height);
+        for (RGBA& p : prev) p = randomColor(rng);
+        Frame curr = nextFrame(rng, prev, width);
+        // Single-channel changes, which a per-pixel compare must still see
+        uint8_t RGBA::* const channels[] = {&RGBA::r, &RGBA::g, &RGBA::b, &RGBA::a};
+        for (int k = pick(rng, 0, 3); k > 0; k--) {
+            RGBA& p = curr[(size_t)pick(rng, 0, (int)curr.size() - 1)];
+            p.*channels[pick(rng, 0, 3)] ^= (uint8_t)(1 << pick(rng, 0, 7));
+        }
+
+        vector<uint8_t> reference, fast;
+        encodeDeltaScalar(prev.data(), curr.data(), curr.size(), width, reference);
+        encodeDelta(prev.data(), curr.data(), curr.size(), width, fast);
+        check(reference == fast, "encodeDelta " + to_string(width) + "x" + to_string(height));
+
+        // And both kinds of delta bring prev back to curr
+        for (uint8_t type : {FRAME_DELTA, FRAME_DELTA_RUNS}) {
+            vector<uint8_t> body;
+            if (type == FRAME_DELTA) body = fast;
+            else encodeDeltaRuns(prev.data(), curr.data(), curr.size(), body);
+            Frame applied = prev;
+            applyDelta(type, body.data(), body.size(), width, height, applied.data());
+            check(sameColors(applied.data(), curr.data(), curr.size()),
+                  "applyDelta type " + to_string((int)type) + " " + to_string(width) + "x" + to_string(height));
+        }
+    }
+}
+
+// Animation for the renderer: a chain of nested ranges deeper than its snapshot budget
+// (F1-n, F1-n-1, ...), then random overlapping ones, pixels mostly inside the frame
+static string randomAnimation(Rng& rng, int width, int height, int frames) {
+    string doc = "info{\nDISPLAY=" + to_string(width) + "X" + to_string(height) + "\nFPS=10\nF="
+               + to_string(frames) + "\nLOOP=Y\n}\n";
+    auto coord = [&](int limit) { return to_string(pick(rng, chance(rng, 0.05) ? 0 : 1, limit + (chance(rng, 0.05) ? 5 : 0))); };
+    auto block = [&](int start, int end) {
+        doc += "F" + to_string(start) + "-" + to_string(end) + "{\n";
+        for (int c = pick(rng, 1, 3); c > 0; c--) {
+            RGBA col = randomColor(rng);
+            if (chance(rng, 0.3)) col.a = 255;
+            if (chance(rng, 0.1)) col.a = 0;
+            doc += "rgba(" + to_string(col.r) + "," + to_string(col.g) + "," + to_string(col.b) + ","
+                 + to_string(col.a) + "){\n";
+            for (int l = pick(rng, 1, 4); l > 0; l--) {
+                if (chance(rng, 0.4)) {
+                    doc += "P=" + coord(width) + "x" + coord(height);
+                    for (int k = pick(rng, 0, 4); k > 0; k--) doc += "," + coord(width) + "x" + coord(height);
+                } else if (chance(rng, 0.5)) {
+                    string y = coord(height);
+                    doc += "PL=" + coord(width) + "x" + y + "-" + coord(width) + "x" + y;
+                } else {
+                    string x = coord(width);
+                    doc += "PL=" + x + "x" + coord(height) + "-" + x + "x" + coord(height);
+                }
+                doc += "\n";
+            }
+            doc += "}\n";
+        }
+        doc += "}\n";
+    };
+
+    int depth = pick(rng, 0, 14);
+    for (int k = 0; k < depth && k < frames; k++) block(1 + (chance(rng, 0.3) ? k / 2 : 0), frames - k);
+    for (int b = pick(rng, 0, 10); b > 0; b--) {
+        int start = pick(rng, 1, frames);
+        block(start, pick(rng, start, frames + (chance(rng, 0.1) ? 3 : 0)));
+    }
+    return doc;
+}
+
+// 🧅 LayeredRenderer (snapshots, copy-on-write, band threads) vs painting every command
+// covering the frame from scratch, in file order, one pixel at a time
+static void testRenderer(Rng& rng, int animations) {
+    for (int a = 0; a < animations; a++) {
+        int width = pick(rng, 1, 40), height = pick(rng, 1, 40), frames = pick(rng, 1, 30);
+        string doc = randomAnimation(rng, width, height, frames);
+        Parser reference = Parser::fromBuffer(doc);
+        reference.parse(1);
+        Parser parsed = Parser::fromBuffer(doc);
+        parsed.parseArena(1);
+
+        for (BlendMode mode : {BlendMode::Classic, BlendMode::Over}) {
+            vector<Frame> expected;
+            for (int f = 1; f <= frames; f++) {
+                Frame frame((size_t)width * height, RGBA{0, 0, 0, 0});
+                for (const Command& cmd : reference.getCommands()) {
+                    if (f < cmd.start || f > cmd.end) continue;
+                    RGBA color = reference.getPalette()[cmd.colorIndex];
+                    for (const Pixel& px : cmd.pixels) {
+                        int x = px.x - 1, y = px.y - 1;
+                        if (x < 0 || x >= width || y < 0 || y >= height) continue;
+                        RGBA& p = frame[(size_t)y * width + x];
+                        p = (mode == BlendMode::Over) ? blendOver(p, color) : blendClassic(p, color);
+                    }
+                }
+                expected.push_back(std::move(frame));
+            }
+
+            for (unsigned threads : {1u, 4u}) {
+                string what = string(mode == BlendMode::Over ? "over" : "classic") + " render, "
+                            + to_string(threads) + " threads, " + to_string(width) + "x" + to_string(height)
+                            + "x" + to_string(frames) + ", animation " + to_string(a);
+                LayeredRenderer renderer(parsed.getArena(), parsed.getPalette(), width, height, frames, mode, threads);
+                for (int f = 0; f < frames; f++) {
+                    FramePtr got = renderer.render(f);
+                    check(got->size() == expected[f].size()
+                          && sameColors(got->data(), expected[f].data(), got->size()),
+                          what + ": frame " + to_string(f));
+                }
+            }
+        }
+    }
+}
+
+// 📼 Encoder → HMICBReader: every --deltas / --keyframes / --layout combination gives
+// back the exact frames, read in order and seeking around
+static void testRoundTrips(Rng& rng, int animations) {
+    struct Layout {
+        const char* name;
+        bool hmicb7, chunked, linked;
+    };
+    const Layout layouts[] = {
+        {"hmicb", false, false, false},
+        {"block", true, false, false},
+        {"chunked", true, true, false},
+        {"linked", true, true, true},
+    };
+
+    for (int a = 0; a < animations; a++) {
+        int width = pick(rng, 1, 48), height = pick(rng, 1, 32), count = pick(rng, 1, 40);
+        vector<FramePtr> frames;
+        Frame f((size_t)width * height, RGBA{0, 0, 0, 0});
+        for (int i = 0; i < count; i++) {
+            f = nextFrame(rng, f, width);
+            frames.push_back(make_shared<Frame>(f));
+        }
+
+        for (int deltas = 0; deltas < 2; deltas++) {
+            for (int keyframes = 0; keyframes < 2; keyframes++) {
+                EncodeOptions encode;
+                encode.runDeltas = (deltas == 1);
+                encode.adaptiveKeyframes = (keyframes == 1);
+                encode.maxKeyframeDistance = pick(rng, 1, 12);
+                encode.deltaLimit = chance(rng, 0.5) ? 0.5 : 1.0;
+
+                MemorySink hmicb;
+                ostream hmicbOut(&hmicb);
+                writeHMICB(hmicbOut, width, height, 30, count, true,
+                           [&](int i) { return frames[i]; }, encode);
+
+                for (const Layout& layout : layouts) {
+                    string what = string(deltas ? "runs" : "pixel") + " deltas, "
+                                + (keyframes ? "adaptive" : "fixed") + " keyframes, " + layout.name + ", "
+                                + to_string(width) + "x" + to_string(height) + "x" + to_string(count);
+                    vector<char> bytes = hmicb.bytes();
+                    if (layout.hmicb7) {
+                        CompressOptions pack;
+                        pack.chunked = layout.chunked;
+                        pack.linked = layout.linked;
+                        pack.level = pick(rng, 1, 12);
+                        pack.threads = (unsigned)pick(rng, 1, 3);
+                        // Tiny chunks so frames spill over into continuation chunks too
+                        if (chance(rng, 0.5)) pack.maxChunkSize = (size_t)pick(rng, 1, 4096);
+                        MemorySink packed;
+                        ostream packedOut(&packed);
+                        compressToHMICB7(hmicb.bytes(), packedOut, pack);
+                        bytes = packed.bytes();
+                    }
+
+                    try {
+                        HMICBReader reader = HMICBReader::fromBuffer(bytes);
+                        check(reader.frameCount() == (size_t)count, what + ": frame count");
+                        vector<size_t> order;
+                        for (int i = 0; i < count; i++) order.push_back((size_t)i);
+                        for (int i = 0; i < count; i++) order.push_back((size_t)pick(rng, 0, count - 1));
+                        for (size_t n : order) {
+                            DecodedFrame got = reader.frame(n);
+                            check(got->size() == frames[n]->size()
+                                  && sameColors(got->data(), frames[n]->data(), got->size()),
+                                  what + ": frame " + to_string(n));
+                        }
+                    } catch (const exception& e) {
+                        check(false, what + ": " + e.what());
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <class Fn>
+static void section(const char* name, Fn fn) {
+    int before = failures;
+    fn();
+    cout<<(failures == before ? "✅ " : "❌ ")<<name<<"\n";
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? (unsigned)strtoul(argv[1], nullptr, 10) : 12345u;
+    Rng rng(seed);
+
+    section("P= / PL= decoding: SIMD vs scalar", [&] { testPixelLines(rng, 200000); });
+    section("parse modes: parallel, spans and arena vs serial parse", [&] { testParseModes(rng, 3000); });
+    section("stream parser: random chunk splits vs whole parse", [&] { testStreamParser(rng, 2000); });
+    section("blend kernels: SIMD vs scalar vs formulas", [&] { testBlend(rng, 100000); });
+    section("layered renderer vs from-scratch painting", [&] { testRenderer(rng, 400); });
+    section("delta coder: SIMD vs scalar, apply round trip", [&] { testDelta(rng, 20000); });
+    section("encoder → HMICBReader round trips", [&] { testRoundTrips(rng, 60); });
+
+    if (failures) {
+        cout<<failures<<" checks failed (seed "<<seed<<")\n";
+        return 1;
+    }
+    cout<<"✅ all good (seed "<<seed<<")\n";
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "hmictrace.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace HMICX;
+
+namespace {
+
+    // One timeline lane, owned by the registry so the spans outlive the thread (the
+    // parse workers and the render thread are gone by stop()). When its thread exits the
+    // lane is retired, and the next new thread with the same name takes it over - so
+    // short-lived workers share a few lanes instead of adding one each, forever
+    struct ThreadBuffer {
+        mutex lock;           // only ever contended by stop()
+        int tid = 0;
+        string name;
+        bool retired = false; // guarded by registryMutex
+        vector<Trace::Event> events;
+    };
+
+    mutex registryMutex;
+    vector<shared_ptr<ThreadBuffer>> registry;
+    uint64_t origin = 0;   // now() at start(), the timeline's zero
+
+    struct Lane {
+        shared_ptr<ThreadBuffer> buffer;
+        ~Lane() {
+            if (!buffer) return;
+            lock_guard<mutex> lock(registryMutex);
+            buffer->retired = true;
+        }
+    };
+    thread_local Lane lane;
+
+    // A retired lane with this name, or a new one
+    void claim(const string& name) {
+        lock_guard<mutex> lock(registryMutex);
+        for (auto& b : registry) {
+            if (b->retired && b->name == name) {
+                b->retired = false;
+                lane.buffer = b;
+                return;
+            }
+        }
+        auto b = make_shared<ThreadBuffer>();
+        b->tid = (int)registry.size() + 1;
+        b->name = name;
+        registry.push_back(b);
+        lane.buffer = b;
+    }
+
+    ThreadBuffer& buffer() {
+        if (!lane.buffer) claim("");
+        return *lane.buffer;
+    }
+
+    void text(ofstream& out, const string& s) {
+        out<<'"';
+        for (unsigned char c : s) {
+            if (c == '"' || c == '\\') out<<'\\'<<c;
+            else if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out<<buf;
+            }
+            else out<<c;
+        }
+        out<<'"';
+    }
+
+    // Trace-event timestamps are microseconds; keep the nanoseconds as decimals
+    void micros(ofstream& out, uint64_t ns) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.3f", ns / 1000.0);
+        out<<buf;
+    }
+
+}  // namespace
+
+void Trace::record(Event&& e) {
+    if (!enabled()) return;
+    ThreadBuffer& b = buffer();
+    lock_guard<mutex> lock(b.lock);
+    b.events.push_back(std::move(e));
+}
+
+void Trace::nameThread(const string& name) {
+    if (!enabled()) return;
+    if (!lane.buffer) {
+        claim(name);
+        return;
+    }
+    ThreadBuffer& b = buffer();
+    lock_guard<mutex> lock(b.lock);
+    b.name = name;
+}
+
+void Trace::start() {
+    {
+        lock_guard<mutex> lock(registryMutex);
+        for (auto& b : registry) {
+            lock_guard<mutex> bl(b->lock);
+            b->events.clear();
+        }
+        origin = now();
+    }
+    recording = true;
+}
+
+void Trace::stop(const string& path) {
+    recording = false;
+
+    ofstream out(path, ios::binary);
+    if (!out) throw runtime_error("cannot create trace file " + path);
+
+    out<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out<<"{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"hmicb\"}}";
+
+    lock_guard<mutex> lock(registryMutex);
+    for (auto& b : registry) {
+        lock_guard<mutex> bl(b->lock);
+        if (!b->name.empty()) {
+            out<<",\n{\"ph\":\"M\",\"pid\":1,\"tid\":"<<b->tid<<",\"name\":\"thread_name\",\"args\":{\"name\":";
+            text(out, b->name);
+            out<<"}}";
+        }
+        for (const Event& e : b->events) {
+            uint64_t begin = max(e.begin, origin);
+            out<<",\n{\"ph\":\"X\",\"pid\":1,\"tid\":"<<b->tid<<",\"name\":";
+            text(out, e.name);
+            out<<",\"cat\":";
+            text(out, e.cat);
+            out<<",\"ts\":";
+            micros(out, begin - origin);
+            out<<",\"dur\":";
+            micros(out, e.end > begin ? e.end - begin : 0);
+            if (e.keys[0] || !e.detail.empty()) {
+                out<<",\"args\":{";
+                bool first = true;
+                for (int k = 0; k < 2; k++) {
+                    if (!e.keys[k]) continue;
+                    if (!first) out<<',';
+                    text(out, e.keys[k]);
+                    out<<':'<<e.values[k];
+                    first = false;
+                }
+                if (!e.detail.empty()) {
+                    if (!first) out<<',';
+                    out<<"\"detail\":";
+                    text(out, e.detail);
+                }
+                out<<'}';
+            }
+            out<<'}';
+        }
+        b->events.clear();
+    }
+    out<<"\n]}\n";
+    out.close();
+    if (!out) throw runtime_error("failed writing trace file " + path);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace HMICX {
+namespace Trace {
+
+    // 🧵 TIMELINE TRACING - Chrome / Perfetto trace-event JSON
+    //
+    //   Trace::start();
+    //   { Trace::Span s("render frame", "render"); s.arg("frame", i); ... }
+    //   Trace::stop("trace.json");   // open in ui.perfetto.dev or chrome://tracing
+    //
+    // Spans become complete ("X") events on the thread that made them, so overlapping
+    // stages (render ahead, parse workers, batch jobs) show up side by side. While not
+    // recording, a Span is one relaxed atomic load and nothing else - no clock reads, no
+    // allocations. Names, categories and arg keys must be string literals (they're kept
+    // as pointers); detail() takes any string.
+
+    inline std::atomic<bool> recording{false};
+
+    inline bool enabled() { return recording.load(std::memory_order_relaxed); }
+
+    inline uint64_t now() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Event {
+        const char* name;
+        const char* cat;
+        uint64_t begin, end;          // now() values
+        const char* keys[2] = {nullptr, nullptr};
+        int64_t values[2] = {0, 0};
+        std::string detail;
+    };
+
+    // Adds a finished span for the calling thread (no-op while not recording)
+    void record(Event&& e);
+    // Label for the calling thread in the timeline ("render", "job 3", ...). Call it first
+    // thing: a thread that has exited hands its lane to the next one named the same
+    void nameThread(const std::string& name);
+
+    // Throws away anything recorded before and starts recording
+    void start();
+    // Stops recording and writes every span so far to `path`. Call it once the threads
+    // that recorded are done; throws runtime_error if the file can't be written
+    void stop(const std::string& path);
+
+    class Span {
+    public:
+        Span(const char* name, const char* cat) : on(enabled()) {
+            if (on) {
+                e.name = name;
+                e.cat = cat;
+                e.begin = now();
+            }
+        }
+        ~Span() {
+            if (on) {
+                e.end = now();
+                record(std::move(e));
+            }
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        // Up to two numbers shown with the span
+        void arg(const char* key, int64_t value) {
+            if (!on) return;
+            int k = e.keys[0] ? 1 : 0;
+            e.keys[k] = key;
+            e.values[k] = value;
+        }
+        void detail(const std::string& text) {
+            if (on) e.detail = text;
+        }
+
+    private:
+        bool on;
+        Event e{};
+    };
+
+}  // namespace Trace
+}  // namespace HMICX
@@ -1,10 +1,33 @@
 #include "hmicx.h"
+#include "hmiclog.h"
+#include "hmictrace.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <iterator>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace HMICX;
@@ -14,8 +37,7 @@ using namespace HMICX;
 // This prevents duplicate definitions and lets the compiler optimize better!!
 
 Parser::Parser(const string& filepath) {
-    cout << "[DEBUG] 🔥 Parser constructor called with: " << filepath << endl;
-    
+    HMICX_DEBUG("[DEBUG] 🔥 Parser constructor called with: " << filepath << '\n');
     ifstream f(filepath, ios::binary | ios::ate);
     if (!f.is_open()) throw runtime_error("Cannot open file: " + filepath);
     
@@ -28,409 +50,1148 @@ Parser::Parser(const string& filepath) {
     }
     f.close();
     
-    cout << "[DEBUG] 📄 File loaded successfully! Size: " << size << " bytes" << endl;
+    data = content;
+    
+    HMICX_DEBUG("[DEBUG] 📄 File loaded successfully! Size: " << size << " bytes\n");
 }
 
-void Parser::parse() {
-    cout << "[DEBUG] 🚀 Starting parse()..." << endl;
-    parseHeader();
-    parseFrames();
-    cout << "[DEBUG] ✅ Parsing complete!" << endl;
+Parser::Parser(string_view buffer, BorrowTag) : data(buffer) {}
+
+Parser Parser::fromBuffer(string_view buffer) {
+    HMICX_DEBUG("[DEBUG] 🔥 Parser over caller buffer, size: " << buffer.size() << " bytes\n");
+    return Parser(buffer, BorrowTag{});
 }
 
-void Parser::parseHeader() {
-    cout << "[DEBUG] 📋 Starting parseHeader()..." << endl;
+Parser Parser::mapFile(const string& filepath) {
+    HMICX_DEBUG("[DEBUG] 🔥 Parser mapping file: " << filepath << '\n');
+    return Parser(MappedFile(filepath));
+}
+
+Parser::Parser(MappedFile&& mapped) : mapping(std::move(mapped)), data(mapping.view()) {
+    HMICX_DEBUG("[DEBUG] 🗺️ File mapped successfully! Size: " << data.size() << " bytes\n");
+}
+
+#ifndef _WIN32
+
+MappedFile::MappedFile(const string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("Cannot open file: " + filepath);
     
-    const char* data = content.c_str();
-    size_t len = content.size();
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw runtime_error("Cannot stat file: " + filepath);
+    }
     
-    for (size_t pos = 0; pos < len - 4; pos++) {
-        if (fastStartsWith(data + pos, len - pos, "info", 4)) {
-            cout << "[DEBUG] 🔍 Found 'info' at position " << pos << endl;
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            addr = nullptr;
+            close(fd);
+            throw runtime_error("Failed to map file: " + filepath);
+        }
+        // We walk it front to back exactly once, so tell the kernel to read ahead
+        madvise(addr, length, MADV_SEQUENTIAL);
+    }
+    close(fd);  // the mapping keeps its own reference
+}
+
+MappedFile::~MappedFile() {
+    if (addr) munmap(addr, length);
+}
+
+#else
+
+// 🪟 No mmap here, fall back to one heap buffer owned by the mapping
+MappedFile::MappedFile(const string& filepath) {
+    ifstream f(filepath, ios::binary | ios::ate);
+    if (!f.is_open()) throw runtime_error("Cannot open file: " + filepath);
+    length = static_cast<size_t>(f.tellg());
+    f.seekg(0, ios::beg);
+    if (length > 0) {
+        addr = new char[length];
+        if (!f.read(static_cast<char*>(addr), length)) {
+            delete[] static_cast<char*>(addr);
+            addr = nullptr;
+            throw runtime_error("Failed to read file: " + filepath);
+        }
+    }
+}
+
+MappedFile::~MappedFile() {
+    delete[] static_cast<char*>(addr);
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : addr(other.addr), length(other.length) {
+    other.addr = nullptr;
+    other.length = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        MappedFile old(std::move(*this));
+        addr = other.addr;
+        length = other.length;
+        other.addr = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+namespace {
+
+    enum class InfoMatch { Found, NotFound, NeedMore };
+
+    // Find the first info{...} block at or after pos. Found: [bodyStart, bodyEnd) is the text
+    // between the braces. NeedMore (only when !final): the buffer ends before we can tell,
+    // everything before pos has been ruled out
+    InfoMatch findInfoBlock(const char* data, size_t len, size_t& pos, bool final,
+                            size_t& bodyStart, size_t& bodyEnd) {
+        for (; pos + 4 < len; pos++) {
+            if (!fastStartsWith(data + pos, len - pos, "info", 4)) continue;
+            HMICX_DEBUG("[DEBUG] 🔍 Found 'info' at position " << pos << '\n');
             
-            pos += 4;
-            while (pos < len && isspace(data[pos])) pos++;
+            size_t p = pos + 4;
+            while (p < len && fastIsSpace(data[p])) p++;
+            if (p >= len) return final ? InfoMatch::NotFound : InfoMatch::NeedMore;
             
-            if (pos < len && data[pos] == '{') {
-                cout << "[DEBUG] 📦 Found opening brace for info block at pos " << pos << endl;
-                
-                size_t end = findMatchingBrace(data, len, pos);
+            if (data[p] == '{') {
+                HMICX_DEBUG("[DEBUG] 📦 Found opening brace for info block at pos " << p << '\n');
+                size_t end = findMatchingBrace(data, len, p);
                 if (end != string::npos) {
-                    cout << "[DEBUG] 📦 Found closing brace at pos " << end << endl;
-                    parseHeaderBody(data + pos + 1, end - pos - 1);
-                    cout << "[DEBUG] ✅ Header parsed successfully!" << endl;
-                    return;
+                    HMICX_DEBUG("[DEBUG] 📦 Found closing brace at pos " << end << '\n');
+                    bodyStart = p + 1;
+                    bodyEnd = end;
+                    return InfoMatch::Found;
                 }
+                if (!final) return InfoMatch::NeedMore;
             }
+            pos = p;
         }
+        return final ? InfoMatch::NotFound : InfoMatch::NeedMore;
     }
-    
-    cout << "[DEBUG] ⚠️ No header found in file!" << endl;
-}
 
-void Parser::parseHeaderBody(const char* body, size_t len) {
-    cout << "[DEBUG] 📝 Parsing header body (length: " << len << ")" << endl;
-    
-    size_t lineStart = 0;
-    int lines_parsed = 0;
-    
-    for (size_t i = 0; i <= len; i++) {
-        if (i == len || body[i] == '\n') {
-            auto [linePtr, lineLen] = fastTrim(body + lineStart, i - lineStart);
-            
-            if (lineLen > 0) {
-                // Find '=' without creating substring
-                const char* eq = (const char*)memchr(linePtr, '=', lineLen);
-                if (eq) {
-                    size_t eqPos = eq - linePtr;
-                    auto [keyPtr, keyLen] = fastTrim(linePtr, eqPos);
-                    auto [valPtr, valLen] = fastTrim(eq + 1, lineLen - eqPos - 1);
-                    
-                    if (keyLen > 0 && valLen > 0) {
-                        string key(keyPtr, keyLen);
-                        transform(key.begin(), key.end(), key.begin(), ::toupper);
-                        string val(valPtr, valLen);
-                        header[key] = val;
-                        lines_parsed++;
-                        cout << "[DEBUG]   📌 " << key << " = " << val << endl;
+    // KEY=VALUE lines -> header map (keys uppercased)
+    void parseHeaderBody(const char* body, size_t len, map<string, string>& header) {
+        HMICX_DEBUG("[DEBUG] 📝 Parsing header body (length: " << len << ")\n");
+        size_t lineStart = 0;
+        int lines_parsed = 0;
+        
+        for (size_t i = 0; i <= len; i++) {
+            if (i == len || body[i] == '\n') {
+                auto [linePtr, lineLen] = fastTrim(body + lineStart, i - lineStart);
+                
+                if (lineLen > 0) {
+                    // Find '=' without creating substring
+                    const char* eq = (const char*)memchr(linePtr, '=', lineLen);
+                    if (eq) {
+                        size_t eqPos = eq - linePtr;
+                        auto [keyPtr, keyLen] = fastTrim(linePtr, eqPos);
+                        auto [valPtr, valLen] = fastTrim(eq + 1, lineLen - eqPos - 1);
+                        
+                        if (keyLen > 0 && valLen > 0) {
+                            string key(keyPtr, keyLen);
+                            transform(key.begin(), key.end(), key.begin(), ::toupper);
+                            string val(valPtr, valLen);
+                            header[key] = val;
+                            lines_parsed++;
+                            HMICX_DEBUG("[DEBUG]   📌 " << key << " = " << val << '\n');
+                        }
                     }
                 }
+                lineStart = i + 1;
             }
-            lineStart = i + 1;
         }
+        
+        HMICX_DEBUG("[DEBUG] 📊 Parsed " << lines_parsed << " header lines\n");
     }
-    
-    cout << "[DEBUG] 📊 Parsed " << lines_parsed << " header lines" << endl;
-}
 
-void Parser::parseFrames() {
-    cout << "[DEBUG] 🎬 Starting parseFrames()..." << endl;
-    
-    const char* data = content.c_str();
-    size_t len = content.size();
-    
-    cout << "[DEBUG] 📄 File length: " << len << " bytes" << endl;
-    cout << "[DEBUG] 📄 First 500 chars of file:" << endl;
-    cout << "=================" << endl;
-    cout << string(data, min(len, (size_t)500)) << endl;
-    cout << "=================" << endl;
+}  // namespace
+
+void Parser::parseHeader() {
+    HMICX_DEBUG("[DEBUG] 📋 Starting parseHeader()...\n");
     
-    // ⚡ Reserve space to avoid reallocation
-    commands.reserve(1000);
+    size_t pos = 0, bodyStart = 0, bodyEnd = 0;
+    if (findInfoBlock(data.data(), data.size(), pos, true, bodyStart, bodyEnd) == InfoMatch::Found) {
+        parseHeaderBody(data.data() + bodyStart, bodyEnd - bodyStart, header);
+        HMICX_DEBUG("[DEBUG] ✅ Header parsed successfully!\n");
+        return;
+    }
     
-    int frames_found = 0;
+    HMICX_DEBUG("[DEBUG] ⚠️ No header found in file!\n");
+}
+
+// 🎨 COLORS 🎨
+
+namespace {
+
+    // "12,34,56" style argument list: exactly n plain decimal numbers (up to 9 digits)
+    // split by single commas. Anything else -> false and the sscanf path decides
+    bool parseColorArgs(const char* p, const char* end, int* out, int n) {
+        for (int i = 0; i < n; i++) {
+            const char* first = p;
+            int v = 0;
+            while (p < end && fastIsDigit(*p) && p - first < 9) v = v * 10 + (*p++ - '0');
+            if (p == first || (p < end && fastIsDigit(*p))) return false;
+            out[i] = v;
+            if (i + 1 < n) {
+                if (p >= end || *p != ',') return false;
+                p++;
+            }
+        }
+        return true;
+    }
+
+    int hexNibble(char c) {
+        if (fastIsDigit(c)) return c - '0';
+        return (c | 0x20) - 'a' + 10;
+    }
+
+    // The common spellings without the lowercase copy / sscanf. false = not canonical
+    bool parseColorFast(string_view s, RGBA& c) {
+        const char* p = s.data();
+        const char* end = p + s.size();
+        int v[4];
+        if (s.size() == 7 && p[0] == '#') {
+            for (int i = 1; i < 7; i++) {
+                if (!isxdigit(static_cast<unsigned char>(p[i]))) return false;
+            }
+            c = {uint8_t(hexNibble(p[1]) * 16 + hexNibble(p[2])),
+                 uint8_t(hexNibble(p[3]) * 16 + hexNibble(p[4])),
+                 uint8_t(hexNibble(p[5]) * 16 + hexNibble(p[6])), 255};
+            return true;
+        }
+        if (fastStartsWith(p, s.size(), "rgba(", 5)) {
+            if (!parseColorArgs(p + 5, end, v, 4)) return false;
+            c = {uint8_t(v[0]), uint8_t(v[1]), uint8_t(v[2]), uint8_t(v[3])};
+            return true;
+        }
+        if (fastStartsWith(p, s.size(), "rgb(", 4)) {
+            if (!parseColorArgs(p + 4, end, v, 3)) return false;
+            c = {uint8_t(v[0]), uint8_t(v[1]), uint8_t(v[2]), 255};
+            return true;
+        }
+        return false;
+    }
+
+}  // namespace
+
+RGBA HMICX::parseColor(string_view s) {
+    RGBA c{255,255,255,255};
+    if (parseColorFast(s, c)) return c;
     
-    for (size_t pos = 0; pos < len - 1; pos++) {
-        if ((data[pos] == 'F' || data[pos] == 'f') && isdigit(data[pos + 1])) {
-            cout << "[DEBUG] 🎯 Found 'F' followed by digit at position " << pos << endl;
-            cout << "[DEBUG]   Context: '" << string(data + pos, min((size_t)20, len - pos)) << "'" << endl;
-            
-            pos++;
-            int start = fastExtractNumber(data, len, pos);
-            int end = start;
+    // Odd spellings (spaces, signs, huge numbers...) - the original sscanf rules
+    string str(s);
+    transform(str.begin(), str.end(), str.begin(), ::tolower);
+    if (str.rfind("#",0)==0 && str.size()==7) {
+        c.r = stoi(str.substr(1,2),nullptr,16);
+        c.g = stoi(str.substr(3,2),nullptr,16);
+        c.b = stoi(str.substr(5,2),nullptr,16);
+    } else if (str.find("rgba(")==0) {
+        int r,g,b,a;
+        if (sscanf(str.c_str(),"rgba(%d,%d,%d,%d)",&r,&g,&b,&a)==4)
+            c={uint8_t(r),uint8_t(g),uint8_t(b),uint8_t(a)};
+    } else if (str.find("rgb(")==0) {
+        int r,g,b;
+        if (sscanf(str.c_str(),"rgb(%d,%d,%d)",&r,&g,&b)==3)
+            c={uint8_t(r),uint8_t(g),uint8_t(b),255};
+    }
+    return c;
+}
+
+string_view Palette::store(string_view text) {
+    // Names go into fixed blocks that are never reallocated, so the views stay put
+    constexpr size_t BLOCK = 16 * 1024;
+    if (blocks.empty() || blockUsed + text.size() > blockSize) {
+        blockSize = max(BLOCK, text.size());
+        blocks.push_back(make_unique<char[]>(blockSize));
+        blockUsed = 0;
+    }
+    char* dst = blocks.back().get() + blockUsed;
+    if (!text.empty()) memcpy(dst, text.data(), text.size());
+    blockUsed += text.size();
+    return {dst, text.size()};
+}
+
+uint32_t Palette::add(string_view text, RGBA color) {
+    auto index = static_cast<uint32_t>(entries.size());
+    entries.push_back(color);
+    names.push_back(store(text));
+    lookup.emplace(names.back(), index);
+    return index;
+}
+
+uint32_t Palette::intern(string_view text) {
+    auto it = lookup.find(text);
+    if (it != lookup.end()) return it->second;
+    return add(text, parseColor(text));
+}
+
+vector<uint32_t> Palette::merge(const Palette& other) {
+    vector<uint32_t> table(other.size());
+    for (uint32_t i = 0; i < other.size(); i++) {
+        auto it = lookup.find(other.names[i]);
+        table[i] = (it != lookup.end()) ? it->second : add(other.names[i], other.entries[i]);
+    }
+    return table;
+}
+
+// 🧮 SCALAR COORDINATE DECODING - THE REFERENCE IMPLEMENTATION 🧮
+
+namespace {
+
+    enum class LineKind { None, Points, Line };
+
+    // Trim + figure out whether this is P=..., PL=... or nothing we care about.
+    // On success [payload, payload + payloadLen) is everything after the '='
+    LineKind classifyLine(const char* line, size_t len, const char*& payload, size_t& payloadLen) {
+        // Trim line inline
+        size_t start = 0;
+        size_t end = len;
+        
+        while (start < end && fastIsSpace(line[start])) start++;
+        while (start < end && fastIsSpace(line[end - 1])) end--;
+        
+        if (end <= start) return LineKind::None;
+        
+        // Check prefix case-insensitively
+        if (end - start > 2 && (line[start] == 'p' || line[start] == 'P') && line[start + 1] == '=') {
+            payload = line + start + 2;
+            payloadLen = end - start - 2;
+            return LineKind::Points;
+        }
+        if (end - start > 3 && (line[start] == 'p' || line[start] == 'P') && 
+            (line[start + 1] == 'l' || line[start + 1] == 'L') && line[start + 2] == '=') {
+            payload = line + start + 3;
+            payloadLen = end - start - 3;
+            return LineKind::Line;
+        }
+        return LineKind::None;
+    }
+
+    // Parse 1x2,3x4
+    void decodePointsScalar(const char* s, size_t end, vector<Pixel>& out) {
+        size_t pos = 0;
+        
+        while (pos < end) {
+            size_t before = pos;
+            int x = 0, y = 0;
+            bool hasX = false, hasY = false;
             
-            if (pos < len && data[pos] == '-') {
+            // Parse x
+            while (pos < end && isdigit(static_cast<unsigned char>(s[pos]))) {
+                x = x * 10 + (s[pos] - '0');
                 pos++;
-                end = fastExtractNumber(data, len, pos);
+                hasX = true;
             }
             
-            cout << "[DEBUG] 📍 Frame range: " << start << "-" << end << endl;
-            
-            // Skip whitespace to find opening brace
-            while (pos < len && isspace(data[pos])) pos++;
-            
-            if (pos >= len) {
-                cout << "[DEBUG] ❌ Reached end of file before finding opening brace!" << endl;
-                continue;
+            if (pos < end && (s[pos] == 'x' || s[pos] == 'X')) {
+                pos++;
+                // Parse y
+                while (pos < end && isdigit(static_cast<unsigned char>(s[pos]))) {
+                    y = y * 10 + (s[pos] - '0');
+                    pos++;
+                    hasY = true;
+                }
             }
             
-            if (data[pos] != '{') {
-                cout << "[DEBUG] ⚠️ No opening brace found! Next char: '" << data[pos] << "' (ASCII " << (int)data[pos] << ")" << endl;
-                continue;
+            if (hasX && hasY) {
+                out.push_back({x, y});
             }
             
-            cout << "[DEBUG] 📦 Frame opening brace at pos " << pos << endl;
-            
-            size_t frameEnd = findMatchingBrace(data, len, pos);
-            
-            if (frameEnd == string::npos) {
-                cout << "[DEBUG] ❌ No matching closing brace for frame!" << endl;
-                continue;
-            }
+            if (pos < end && s[pos] == ',') pos++;
+            while (pos < end && isspace(static_cast<unsigned char>(s[pos]))) pos++;
             
-            size_t frameBodyLen = frameEnd - pos - 1;
-            cout << "[DEBUG] 📦 Frame closing brace at pos " << frameEnd << " (body length: " << frameBodyLen << ")" << endl;
-            
-            if (frameBodyLen > 0) {
-                cout << "[DEBUG] 📄 Frame body preview (first 200 chars):" << endl;
-                cout << "~~~~~~~~~~~~~~~~~" << endl;
-                cout << string(data + pos + 1, min((size_t)200, frameBodyLen)) << endl;
-                cout << "~~~~~~~~~~~~~~~~~" << endl;
-                
-                parseFrameBody(data + pos + 1, frameBodyLen, start, end);
-            } else {
-                cout << "[DEBUG] ⚠️ Frame body is empty!" << endl;
+            // Junk character - step over it instead of spinning forever
+            if (pos == before) pos++;
+        }
+    }
+
+    // Expand a horizontal or vertical line into pixels (diagonals are ignored)
+    void emitLine(int x1, int y1, int x2, int y2, vector<Pixel>& out) {
+        if (y1 != y2 && x1 != x2) return;
+        
+        // Grow once and fill, instead of a push_back per pixel
+        bool horizontal = (y1 == y2);
+        int from = horizontal ? min(x1, x2) : min(y1, y2);
+        int to = horizontal ? max(x1, x2) : max(y1, y2);
+        size_t base = out.size();
+        out.resize(base + static_cast<size_t>(to - from) + 1);
+        Pixel* dst = out.data() + base;
+        for (int v = from; v <= to; v++) {
+            *dst++ = horizontal ? Pixel{v, y1} : Pixel{x1, v};
+        }
+    }
+
+    // Parse 1x1-10x1 into its end points v = {x1, y1, x2, y2}
+    void decodeLineScalar(const char* s, size_t end, int v[4]) {
+        int& x1 = v[0];
+        int& y1 = v[1];
+        int& x2 = v[2];
+        int& y2 = v[3];
+        x1 = y1 = x2 = y2 = 0;
+        int* current = &x1;
+        
+        for (size_t pos = 0; pos < end; pos++) {
+            if (isdigit(static_cast<unsigned char>(s[pos]))) {
+                *current = *current * 10 + (s[pos] - '0');
+            } else if (s[pos] == 'x' || s[pos] == 'X') {
+                if (current == &x1) current = &y1;
+                else if (current == &x2) current = &y2;
+            } else if (s[pos] == '-') {
+                current = &x2;
             }
-            
-            pos = frameEnd;
-            frames_found++;
         }
     }
-    
-    cout << "[DEBUG] 🎬 Total frames found: " << frames_found << endl;
-    cout << "[DEBUG] 📊 Total commands: " << commands.size() << endl;
+
+    // Span form of emitLine: a run instead of a pixel per step (single pixels stay points).
+    // Spans = anything with points/rows/columns vectors (SpanCommand, CommandArena)
+    template <class Spans>
+    void emitRun(const int v[4], Spans& out) {
+        int x1 = v[0], y1 = v[1], x2 = v[2], y2 = v[3];
+        if (y1 != y2 && x1 != x2) return;
+        
+        if (x1 == x2 && y1 == y2) out.points.push_back({x1, y1});
+        else if (y1 == y2) out.rows.push_back({min(x1, x2), y1, max(x1, x2) - min(x1, x2) + 1});
+        else out.columns.push_back({x1, min(y1, y2), max(y1, y2) - min(y1, y2) + 1});
+    }
+
+}  // namespace
+
+void HMICX::parsePixelLineScalar(const char* line, size_t len, vector<Pixel>& out) {
+    const char* payload = nullptr;
+    size_t n = 0;
+    switch (classifyLine(line, len, payload, n)) {
+        case LineKind::Points: decodePointsScalar(payload, n, out); break;
+        case LineKind::Line: {
+            int v[4];
+            decodeLineScalar(payload, n, v);
+            emitLine(v[0], v[1], v[2], v[3], out);
+            break;
+        }
+        case LineKind::None:   break;
+    }
 }
 
-void Parser::parseFrameBody(const char* body, size_t len, int start, int end) {
-    cout << "[DEBUG] 🔍 parseFrameBody called! Frame " << start << "-" << end << ", body length: " << len << endl;
-    
-    size_t pos = 0;
-    int colors_found = 0;
-    int commands_before = commands.size();
-    
-    while (pos < len) {
-        string color;
+// 🏎️ VECTORIZED COORDINATE DECODING 🏎️
+// Classify up to 64 payload bytes at once into digit / 'x' / '-' / ',' bitmasks,
+// then turn every digit run into a number with one SWAR multiply chain instead of
+// a multiply-accumulate per character. Anything that isn't the strict canonical
+// form (spaces, junk, >9 digit numbers, >64 bytes) goes to the scalar path, so
+// the results always match parsePixelLineScalar.
+
+// These helpers are tiny and called per line - make sure they really get inlined
+#define HMICX_FORCE_INLINE inline __attribute__((always_inline))
+
+namespace {
+
+    constexpr size_t FAST_MAX = 64;   // payload bytes handled by the fast path
+
+    struct ClassMasks {
+        uint64_t digit, x, dash, comma;
+    };
+
+#if defined(__AVX2__)
+    constexpr size_t FAST_BLOCK = 32;
+
+    // Classify ceil(n / 32) blocks starting at p
+    HMICX_FORCE_INLINE ClassMasks classify(const char* p, size_t n) {
+        const __m256i zero = _mm256_set1_epi8('0');
+        const __m256i nine = _mm256_set1_epi8(9);
+        const __m256i lowerX = _mm256_set1_epi8('x');
+        const __m256i caseBit = _mm256_set1_epi8(0x20);
+        const __m256i dash = _mm256_set1_epi8('-');
+        const __m256i comma = _mm256_set1_epi8(',');
+        ClassMasks m{0, 0, 0, 0};
+        for (size_t half = 0; half * 32 < n; half++) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + half * 32));
+            __m256i t = _mm256_sub_epi8(v, zero);
+            __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(t, nine), t);
+            __m256i isX = _mm256_cmpeq_epi8(_mm256_or_si256(v, caseBit), lowerX);
+            unsigned shift = static_cast<unsigned>(half * 32);
+            m.digit |= uint64_t(uint32_t(_mm256_movemask_epi8(isDigit))) << shift;
+            m.x     |= uint64_t(uint32_t(_mm256_movemask_epi8(isX))) << shift;
+            m.dash  |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, dash)))) << shift;
+            m.comma |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, comma)))) << shift;
+        }
+        return m;
+    }
+#elif defined(__SSE2__)
+    constexpr size_t FAST_BLOCK = 16;
+
+    // Classify ceil(n / 16) blocks starting at p
+    HMICX_FORCE_INLINE ClassMasks classify(const char* p, size_t n) {
+        const __m128i zero = _mm_set1_epi8('0');
+        const __m128i nine = _mm_set1_epi8(9);
+        const __m128i lowerX = _mm_set1_epi8('x');
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+        const __m128i dash = _mm_set1_epi8('-');
+        const __m128i comma = _mm_set1_epi8(',');
+        ClassMasks m{0, 0, 0, 0};
+        for (size_t q = 0; q * 16 < n; q++) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + q * 16));
+            __m128i t = _mm_sub_epi8(v, zero);
+            __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(t, nine), t);
+            __m128i isX = _mm_cmpeq_epi8(_mm_or_si128(v, caseBit), lowerX);
+            unsigned shift = static_cast<unsigned>(q * 16);
+            m.digit |= uint64_t(uint32_t(_mm_movemask_epi8(isDigit))) << shift;
+            m.x     |= uint64_t(uint32_t(_mm_movemask_epi8(isX))) << shift;
+            m.dash  |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, dash)))) << shift;
+            m.comma |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)))) << shift;
+        }
+        return m;
+    }
+#else
+    constexpr size_t FAST_BLOCK = 1;
+
+    HMICX_FORCE_INLINE ClassMasks classify(const char* p, size_t n) {
+        ClassMasks m{0, 0, 0, 0};
+        for (size_t i = 0; i < n; i++) {
+            unsigned char c = static_cast<unsigned char>(p[i]);
+            uint64_t bit = uint64_t(1) << i;
+            if (c >= '0' && c <= '9') m.digit |= bit;
+            else if ((c | 0x20) == 'x') m.x |= bit;
+            else if (c == '-') m.dash |= bit;
+            else if (c == ',') m.comma |= bit;
+        }
+        return m;
+    }
+#endif
+
+    // Up to 8 ASCII digits starting at `first` -> number, no per-digit loop.
+    // Reads 8 bytes from `first`, so the caller guarantees they are readable
+    HMICX_FORCE_INLINE uint32_t swarDigits(const char* first, int count) {
+        uint64_t v;
+        memcpy(&v, first, 8);
+        unsigned shift = 8 * (8 - count);
+        v <<= shift;                                     // digits move into the high bytes, zeros below
+        v -= 0x3030303030303030ULL & (~uint64_t(0) << shift);
+        v = (v * 10) + (v >> 8);
+        v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+             (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+        return static_cast<uint32_t>(v);
+    }
+
+    // Same for up to 4 digits (the usual case for coordinates) in 32-bit lanes
+    HMICX_FORCE_INLINE uint32_t swarDigits4(const char* first, int count) {
+        uint32_t v;
+        memcpy(&v, first, 4);
+        unsigned shift = 8 * (4 - count);
+        v <<= shift;
+        v -= 0x30303030u & (~uint32_t(0) << shift);
+        v = (v * 10) + (v >> 8);                             // digit pairs -> 0..99 in bytes 0 and 2
+        return ((v & 0x00FF00FFu) * ((100u << 16) + 1)) >> 16;  // hi pair * 100 + lo pair
+    }
+
+    // Classified payload: digit runs are in `starts`/`ends`, every delimiter is a single
+    // character sitting between two runs (already validated)
+    struct RunCursor {
+        const char* p;
+        size_t n;
+        uint64_t starts, ends;
+
+        bool done() const { return starts == 0; }
+
+        // Value of the next digit run, and the delimiter after it (0 after the last run)
+        HMICX_FORCE_INLINE bool next(int& value, char& sep) {
+            int a = __builtin_ctzll(starts);
+            int b = __builtin_ctzll(ends);
+            int count = b - a + 1;
+            if (count > 9) return false;
+            if (count <= 4) value = static_cast<int>(swarDigits4(p + a, count));
+            else if (count < 9) value = static_cast<int>(swarDigits(p + a, count));
+            else value = static_cast<int>(uint32_t(p[a] - '0') * 100000000u + swarDigits(p + a + 1, 8));
+            sep = (static_cast<size_t>(b) + 1 < n) ? p[b + 1] : 0;
+            starts &= starts - 1;
+            ends &= ends - 1;
+            return true;
+        }
+    };
+
+    // Pick where the vector loads read from: straight from s when [s, readableEnd) covers
+    // every vector and SWAR read, otherwise a zero-padded copy in scratch
+    HMICX_FORCE_INLINE const char* payloadView(const char* s, size_t n, const char* readableEnd, char* scratch) {
+        size_t span = (n + FAST_BLOCK - 1) / FAST_BLOCK * FAST_BLOCK;
+        size_t need = max(span, n + 8);
+        if (readableEnd && readableEnd >= s && static_cast<size_t>(readableEnd - s) >= need) return s;
+        memset(scratch, 0, need);
+        memcpy(scratch, s, n);
+        return scratch;
+    }
+
+    HMICX_FORCE_INLINE uint64_t liveMask(size_t n) {
+        return (n == 64) ? ~uint64_t(0) : ((uint64_t(1) << n) - 1);
+    }
+
+    // Check the classified payload is strictly <digits>(<delim><digits>)*
+    HMICX_FORCE_INLINE bool prepareRuns(const char* p, size_t n, ClassMasks m, RunCursor& cur) {
+        uint64_t live = liveMask(n);
+        m.digit &= live;
+        if (((m.digit | m.x | m.dash | m.comma) & live) != live) return false;   // spaces or junk
         
-        // 🎨 Check for rgba(...)
-        if (pos + 5 <= len && fastStartsWith(body + pos, len - pos, "rgba(", 5)) {
-            cout << "[DEBUG]   🎨 Found 'rgba(' at pos " << pos << endl;
-            
-            size_t parenEnd = pos + 5;
-            while (parenEnd < len && body[parenEnd] != ')') parenEnd++;
-            
-            if (parenEnd < len && body[parenEnd] == ')') {
-                color.assign(body + pos, parenEnd - pos + 1);
-                cout << "[DEBUG]   ✅ Extracted RGBA color: " << color << endl;
-                pos = parenEnd + 1;
-                colors_found++;
-            } else {
-                cout << "[DEBUG]   ❌ RGBA has no closing paren! parenEnd=" << parenEnd << ", len=" << len << endl;
-                pos++;
-                continue;
+        uint64_t starts = m.digit & ~(m.digit << 1);
+        uint64_t ends = m.digit & ~(m.digit >> 1);
+        uint64_t delims = live & ~m.digit;
+        if (!(m.digit & 1) || !((ends >> (n - 1)) & 1)) return false;      // digits at both ends
+        if (delims & ~(ends << 1)) return false;                           // lone delimiters only
+        
+        cur = {p, n, starts, ends};
+        return true;
+    }
+
+    HMICX_FORCE_INLINE bool isXSep(char c) { return c == 'x' || c == 'X'; }
+
+    // 1x2,3x4,... -> pixels, false (and nothing appended) if the payload needs the scalar path
+    bool decodePointsFast(const char* s, size_t n, const char* readableEnd, vector<Pixel>& out) {
+        if (n == 0 || n > FAST_MAX) return false;
+        alignas(32) char scratch[FAST_MAX + FAST_BLOCK + 8];
+        const char* p = payloadView(s, n, readableEnd, scratch);
+        ClassMasks m = classify(p, n);
+        
+        // Hot case, the vast majority of lines: one AxB with up to 4 digits each side.
+        // A single non-digit that is an 'x' settles the whole line
+        uint64_t other = liveMask(n) & ~m.digit;
+        if (n <= 9 && other && !(other & (other - 1)) && (other & m.x)) {
+            int k = __builtin_ctzll(other);
+            int right = static_cast<int>(n) - k - 1;
+            if (k >= 1 && k <= 4 && right >= 1 && right <= 4) {
+                out.push_back({static_cast<int>(swarDigits4(p, k)),
+                               static_cast<int>(swarDigits4(p + k + 1, right))});
+                return true;
             }
         }
-        // 🎨 Check for rgb(...)
-        else if (pos + 4 <= len && fastStartsWith(body + pos, len - pos, "rgb(", 4)) {
-            cout << "[DEBUG]   🎨 Found 'rgb(' at pos " << pos << endl;
-            
-            size_t parenEnd = pos + 4;
-            while (parenEnd < len && body[parenEnd] != ')') parenEnd++;
-            
-            if (parenEnd < len && body[parenEnd] == ')') {
-                color.assign(body + pos, parenEnd - pos + 1);
-                cout << "[DEBUG]   ✅ Extracted RGB color: " << color << endl;
-                pos = parenEnd + 1;
-                colors_found++;
-            } else {
-                cout << "[DEBUG]   ❌ RGB has no closing paren!" << endl;
-                pos++;
-                continue;
+        
+        RunCursor cur;
+        if (!prepareRuns(p, n, m, cur)) return false;
+        
+        size_t before = out.size();
+        while (!cur.done()) {
+            int x, y;
+            char sep;
+            if (!cur.next(x, sep) || !isXSep(sep) || cur.done() || !cur.next(y, sep) ||
+                (sep != ',' && sep != 0)) {
+                out.resize(before);
+                return false;
             }
+            out.push_back({x, y});
         }
-        // Check for hex color
-        else if (pos < len && body[pos] == '#' && pos + 7 <= len) {
-            bool isHex = true;
-            for (int i = 1; i <= 6; i++) {
-                if (!isxdigit(body[pos + i])) {
-                    isHex = false;
-                    break;
-                }
-            }
-            if (isHex) {
-                color.assign(body + pos, 7);
-                cout << "[DEBUG]   ✅ Extracted HEX color: " << color << endl;
-                pos += 7;
-                colors_found++;
-            } else {
-                pos++;
-                continue;
+        return true;
+    }
+
+    // 1x1-10x1 -> end points {x1, y1, x2, y2}, false if the payload needs the scalar path
+    bool decodeLineFast(const char* s, size_t n, const char* readableEnd, int v[4]) {
+        if (n == 0 || n > FAST_MAX) return false;
+        alignas(32) char scratch[FAST_MAX + FAST_BLOCK + 8];
+        const char* p = payloadView(s, n, readableEnd, scratch);
+        RunCursor cur;
+        if (!prepareRuns(p, n, classify(p, n), cur)) return false;
+        
+        char sep[4];
+        for (int i = 0; i < 4; i++) {
+            if (cur.done() || !cur.next(v[i], sep[i])) return false;
+        }
+        return cur.done() && isXSep(sep[0]) && sep[1] == '-' && isXSep(sep[2]);
+    }
+
+    // PL= payload -> end points, fast path first
+    HMICX_FORCE_INLINE void decodeLine(const char* s, size_t n, const char* readableEnd, int v[4]) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (decodeLineFast(s, n, readableEnd, v)) return;
+#else
+        (void)readableEnd;
+#endif
+        decodeLineScalar(s, n, v);
+    }
+
+}  // namespace
+
+void HMICX::parsePixelLine(const char* line, size_t len, vector<Pixel>& out, const char* readableEnd) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const char* payload = nullptr;
+    size_t n = 0;
+    switch (classifyLine(line, len, payload, n)) {
+        case LineKind::Points:
+            if (!decodePointsFast(payload, n, readableEnd, out)) decodePointsScalar(payload, n, out);
+            break;
+        case LineKind::Line: {
+            int v[4];
+            decodeLine(payload, n, readableEnd, v);
+            emitLine(v[0], v[1], v[2], v[3], out);
+            break;
+        }
+        case LineKind::None:
+            break;
+    }
+#else
+    // SWAR digit conversion assumes little-endian loads
+    (void)readableEnd;
+    parsePixelLineScalar(line, len, out);
+#endif
+}
+
+namespace {
+
+    template <class Spans>
+    void addSpanLine(const char* line, size_t len, Spans& out, const char* readableEnd) {
+        const char* payload = nullptr;
+        size_t n = 0;
+        switch (classifyLine(line, len, payload, n)) {
+            case LineKind::Points:
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                if (decodePointsFast(payload, n, readableEnd, out.points)) break;
+#endif
+                decodePointsScalar(payload, n, out.points);
+                break;
+            case LineKind::Line: {
+                int v[4];
+                decodeLine(payload, n, readableEnd, v);
+                emitRun(v, out);
+                break;
             }
+            case LineKind::None:
+                break;
         }
-        else {
-            // No color found at this position, move forward
-            pos++;
-            continue;
+    }
+
+}  // namespace
+
+void HMICX::parsePixelLine(const char* line, size_t len, SpanCommand& out, const char* readableEnd) {
+    addSpanLine(line, len, out, readableEnd);
+}
+
+namespace {
+
+    // Pixel-list vs span form, so one collector serves both
+    size_t pixelCount(const Command& cmd) { return cmd.pixels.size(); }
+    size_t pixelCount(const SpanCommand& cmd) { return cmd.pixelCount(); }
+    void resetPixels(Command& cmd) { cmd.pixels = {}; cmd.pixels.reserve(100); }
+    void resetPixels(SpanCommand& cmd) { cmd.points = {}; cmd.rows = {}; cmd.columns = {}; }
+    void addLine(Command& cmd, const char* line, size_t len, const char* bufEnd) {
+        parsePixelLine(line, len, cmd.pixels, bufEnd);
+    }
+    void addLine(SpanCommand& cmd, const char* line, size_t len, const char* bufEnd) {
+        parsePixelLine(line, len, cmd, bufEnd);
+    }
+
+    // Frame bookkeeping shared by the collectors below
+    struct FrameTracker {
+        const char* bufEnd;   // end of the buffer being scanned, lets the SIMD decoder load in place
+        Palette& palette;     // colors of emitted commands get interned here
+        int start = 0, end = 0;
+        int frames = 0;
+        int colors = 0;
+        size_t emitted = 0;
+        uint64_t frameBegun = 0;   // trace timestamp of the open F-block, 0 = not tracing
+        
+        FrameTracker(const char* e, Palette& p) : bufEnd(e), palette(p) {}
+        
+        void onFrameBegin(int s, int e) {
+            start = s;
+            end = e;
+            frames++;
+            frameBegun = Trace::enabled() ? Trace::now() : 0;
+            HMICX_DEBUG("[DEBUG] 📍 Frame range: " << s << "-" << e << '\n');
         }
         
-        // At this point, we MUST have a non-empty color
-        if (color.empty()) {
-            cout << "[DEBUG]   ❌ Color is empty after detection?!" << endl;
-            continue;
+        void onFrameEnd() {
+            if (frameBegun) {
+                Trace::Event ev;
+                ev.name = "F-block";
+                ev.cat = "parse";
+                ev.begin = frameBegun;
+                ev.end = Trace::now();
+                ev.keys[0] = "start";
+                ev.values[0] = start;
+                ev.keys[1] = "end";
+                ev.values[1] = end;
+                Trace::record(std::move(ev));
+                frameBegun = 0;
+            }
         }
+    };
+
+    // 📥 Scanner handler that turns color blocks into Cmds (Command or SpanCommand) and
+    // hands each finished one to emit(Cmd&&)
+    template <class Cmd, class Emit>
+    struct CommandCollector : FrameTracker {
+        Emit emit;
+        Cmd cmd{};
         
-        // Skip whitespace to find opening brace
-        cout << "[DEBUG]   🔍 Looking for opening brace after color..." << endl;
-        while (pos < len && isspace(body[pos])) pos++;
+        CommandCollector(Emit e, const char* end, Palette& p) : FrameTracker(end, p), emit(std::move(e)) {}
         
-        if (pos >= len) {
-            cout << "[DEBUG]   ❌ Reached end of body!" << endl;
-            break;
+        void onColor(const char* c, size_t len) {
+            cmd.color.assign(c, len);
+            resetPixels(cmd);
+            colors++;
         }
         
-        if (body[pos] != '{') {
-            cout << "[DEBUG]   ⚠️ No opening brace found for color " << color << "! Next char: '" << body[pos] << "' (ASCII " << (int)body[pos] << ")" << endl;
-            continue;
+        void onPixelLine(const char* line, size_t len) {
+            addLine(cmd, line, len, bufEnd);
         }
         
-        cout << "[DEBUG]   📦 Found opening brace at pos " << pos << endl;
+        void onColorEnd() {
+            size_t n = pixelCount(cmd);
+            HMICX_DEBUG("[DEBUG]   💎 Parsed " << n << " pixels for color " << cmd.color << '\n');
+            if (n > 0) {
+                cmd.start = start;
+                cmd.end = end;
+                cmd.colorIndex = palette.intern(cmd.color);
+                emit(std::move(cmd));
+                emitted++;
+            } else {
+                HMICX_DEBUG("[DEBUG]   ⚠️ No pixels found in color block!\n");
+            }
+            cmd = {};
+        }
+    };
+
+    // Emit target for the whole-file parse
+    template <class Cmd>
+    struct AppendTo {
+        vector<Cmd>& out;
+        void operator()(Cmd&& cmd) { out.push_back(std::move(cmd)); }
+    };
+
+    // 🧱 Scanner handler that decodes straight into the pools of a CommandArena - no
+    // per-command vectors or strings at all
+    struct ArenaCollector : FrameTracker {
+        CommandArena& arena;
+        ArenaCommand cmd{};
+        string color;   // keeps its capacity, so no allocation per block either
         
-        // Find matching closing brace
-        size_t blockEnd = findMatchingBrace(body, len, pos);
+        ArenaCollector(CommandArena& a, const char* end, Palette& p) : FrameTracker(end, p), arena(a) {}
         
-        if (blockEnd == string::npos) {
-            cout << "[DEBUG]   ❌ No matching closing brace!" << endl;
-            break;
+        void onColor(const char* c, size_t len) {
+            cmd = {};
+            color.assign(c, len);
+            cmd.pointsBegin = static_cast<uint32_t>(arena.points.size());
+            cmd.rowsBegin = static_cast<uint32_t>(arena.rows.size());
+            cmd.columnsBegin = static_cast<uint32_t>(arena.columns.size());
+            colors++;
         }
         
-        size_t pixelBodyLen = blockEnd - pos - 1;
-        cout << "[DEBUG]   📦 Found closing brace at pos " << blockEnd << " (pixel body length: " << pixelBodyLen << ")" << endl;
-        
-        if (pixelBodyLen > 0) {
-            cout << "[DEBUG]   📄 Pixel body preview (first 100 chars): " << string(body + pos + 1, min((size_t)100, pixelBodyLen)) << endl;
+        void onPixelLine(const char* line, size_t len) {
+            addSpanLine(line, len, arena, bufEnd);
         }
         
-        // Parse pixels inside the block
-        vector<Pixel> pixels = parsePixels(body + pos + 1, pixelBodyLen);
+        void onColorEnd() {
+            cmd.pointsCount = static_cast<uint32_t>(arena.points.size() - cmd.pointsBegin);
+            cmd.rowsCount = static_cast<uint32_t>(arena.rows.size() - cmd.rowsBegin);
+            cmd.columnsCount = static_cast<uint32_t>(arena.columns.size() - cmd.columnsBegin);
+            size_t n = arena.pixelCount(cmd);
+            HMICX_DEBUG("[DEBUG]   💎 Parsed " << n << " pixels for color " << color << '\n');
+            if (n > 0) {
+                cmd.start = start;
+                cmd.end = end;
+                cmd.colorIndex = palette.intern(color);
+                arena.commands.push_back(cmd);
+                emitted++;
+            } else {
+                HMICX_DEBUG("[DEBUG]   ⚠️ No pixels found in color block!\n");
+            }
+            if (arena.points.size() > UINT32_MAX || arena.rows.size() > UINT32_MAX ||
+                arena.columns.size() > UINT32_MAX) {
+                throw runtime_error("CommandArena: pool offsets overflow 32 bits");
+            }
+        }
+    };
+
+    // What parseFrames/parseFramesParallel need to know about each output kind
+    template <class Cmd>
+    CommandCollector<Cmd, AppendTo<Cmd>> makeCollector(vector<Cmd>& out, const char* end, Palette& palette) {
+        return {AppendTo<Cmd>{out}, end, palette};
+    }
+    ArenaCollector makeCollector(CommandArena& out, const char* end, Palette& palette) {
+        return {out, end, palette};
+    }
+    
+    template <class Cmd>
+    size_t commandCount(const vector<Cmd>& out) { return out.size(); }
+    [[maybe_unused]] size_t commandCount(const CommandArena& out) { return out.commands.size(); }   // only logging uses it
+    
+    template <class Cmd>
+    void reserveCommands(vector<Cmd>& out) { out.reserve(1000); }
+    void reserveCommands(CommandArena& out) { out.commands.reserve(1000); }
+    
+    // Per-frame palette index -> merged palette index
+    template <class Cmd>
+    void remapColors(vector<Cmd>& part, const vector<uint32_t>& table) {
+        for (auto& cmd : part) cmd.colorIndex = table[cmd.colorIndex];
+    }
+    void remapColors(CommandArena& part, const vector<uint32_t>& table) {
+        for (auto& cmd : part.commands) cmd.colorIndex = table[cmd.colorIndex];
+    }
+    
+    // Append per-frame results in frame order
+    template <class Cmd>
+    void mergeParts(vector<Cmd>& out, vector<vector<Cmd>>& parts) {
+        size_t total = 0;
+        for (const auto& list : parts) total += list.size();
+        out.reserve(out.size() + total);
+        for (auto& list : parts) {
+            move(list.begin(), list.end(), back_inserter(out));
+        }
+    }
+    
+    void mergeParts(CommandArena& out, vector<CommandArena>& parts) {
+        size_t cmds = 0, points = 0, rows = 0, columns = 0;
+        for (const auto& a : parts) {
+            cmds += a.commands.size();
+            points += a.points.size();
+            rows += a.rows.size();
+            columns += a.columns.size();
+        }
+        if (out.points.size() + points > UINT32_MAX || out.rows.size() + rows > UINT32_MAX ||
+            out.columns.size() + columns > UINT32_MAX) {
+            throw runtime_error("CommandArena: pool offsets overflow 32 bits");
+        }
+        out.commands.reserve(out.commands.size() + cmds);
+        out.points.reserve(out.points.size() + points);
+        out.rows.reserve(out.rows.size() + rows);
+        out.columns.reserve(out.columns.size() + columns);
         
-        cout << "[DEBUG]   💎 Parsed " << pixels.size() << " pixels for color " << color << endl;
+        for (auto& a : parts) {
+            auto pointsBase = static_cast<uint32_t>(out.points.size());
+            auto rowsBase = static_cast<uint32_t>(out.rows.size());
+            auto columnsBase = static_cast<uint32_t>(out.columns.size());
+            for (ArenaCommand cmd : a.commands) {
+                cmd.pointsBegin += pointsBase;
+                cmd.rowsBegin += rowsBase;
+                cmd.columnsBegin += columnsBase;
+                out.commands.push_back(cmd);
+            }
+            out.points.insert(out.points.end(), a.points.begin(), a.points.end());
+            out.rows.insert(out.rows.end(), a.rows.begin(), a.rows.end());
+            out.columns.insert(out.columns.end(), a.columns.begin(), a.columns.end());
+            a = {};   // release as we go
+        }
+    }
+
+}  // namespace
+
+template <class Out>
+void Parser::parseFrames(Out& commands) {
+    HMICX_DEBUG("[DEBUG] 🎬 Starting parseFrames()...\n");
+    
+    const char* data = this->data.data();
+    size_t len = this->data.size();
+    
+    HMICX_DEBUG("[DEBUG] 📄 File length: " << len << " bytes\n");
+    HMICX_DEBUG("[DEBUG] 📄 First 500 chars of file:\n"
+                << "=================\n"
+                << string_view(data, min(len, (size_t)500)) << '\n'
+                << "=================\n");
+    
+    // ⚡ Reserve space to avoid reallocation
+    reserveCommands(commands);
+    
+    // 🔎 One pass over the whole file, no brace rescans
+    auto collector = makeCollector(commands, data + len, palette);
+    FrameScanner scanner;
+    scanner.scan(data, len, collector);
+    
+    HMICX_DEBUG("[DEBUG] 🎬 Total frames found: " << collector.frames << '\n');
+    HMICX_DEBUG("[DEBUG] 🎨 Total color blocks: " << collector.colors << '\n');
+    HMICX_DEBUG("[DEBUG] 📊 Total commands: " << commandCount(commands) << '\n');
+    HMICX_SUMMARY("parse", "bytes=" << len << " frame_blocks=" << collector.frames << " commands=" << commandCount(commands));
+}
+
+vector<FrameSlice> FrameScanner::splitFrames(const char* s, size_t len) {
+    vector<FrameSlice> slices;
+    size_t pos = 0;
+    
+    while (pos < len) {
+        int start = 0, end = 0;
+        if (matchFrameHeader(s, len, pos, true, start, end) != HeaderMatch::Open) continue;
         
-        if (!pixels.empty()) {
-            commands.push_back({start, end, std::move(pixels), std::move(color)});
-            cout << "[DEBUG]   ✅ Added command with " << pixels.size() << " pixels" << endl;
-        } else {
-            cout << "[DEBUG]   ⚠️ No pixels found in color block!" << endl;
+        // Plain brace counting - colors never contain braces, so this is exactly
+        // where scan() would close the frame
+        size_t body = pos;
+        int depth = 1;
+        while (pos < len) {
+            char c = s[pos++];
+            if (c == '{') depth++;
+            else if (c == '}' && --depth == 0) break;
         }
         
-        // Move past the closing brace
-        pos = blockEnd + 1;
+        // An unterminated last frame runs to the end of the buffer, like in scan()
+        size_t bodyEnd = (depth == 0) ? pos - 1 : len;
+        slices.push_back({start, end, body, bodyEnd - body});
     }
     
-    int commands_added = commands.size() - commands_before;
-    cout << "[DEBUG] 🎨 Frame summary: " << colors_found << " colors found, " << commands_added << " commands added" << endl;
+    return slices;
 }
 
-vector<Pixel> Parser::parsePixels(const char* body, size_t len) {
-    cout << "[DEBUG]     🔍 parsePixels called with length " << len << endl;
+template <class Out>
+void Parser::parseFramesParallel(Out& commands, unsigned threads) {
+    HMICX_DEBUG("[DEBUG] 🎬 Starting parseFramesParallel() with " << threads << " threads...\n");
     
-    vector<Pixel> pixels;
-    pixels.reserve(100);
+    const char* data = this->data.data();
+    size_t len = this->data.size();
     
-    size_t lineStart = 0;
-    int lines_processed = 0;
-    int p_commands = 0;
-    int pl_commands = 0;
+    // 1️⃣ Cheap pass: where are the F-blocks?
+    vector<FrameSlice> slices = FrameScanner::splitFrames(data, len);
+    HMICX_DEBUG("[DEBUG] 🎬 Found " << slices.size() << " frame blocks\n");
     
-    for (size_t i = 0; i <= len; i++) {
-        if (i == len || body[i] == '\n') {
-            // Trim line inline
-            size_t start = lineStart;
-            size_t end = i;
-            
-            while (start < end && isspace(body[start])) start++;
-            while (start < end && isspace(body[end - 1])) end--;
-            
-            if (end > start) {
-                lines_processed++;
-                
-                // Check prefix case-insensitively
-                if (end - start > 2 && (body[start] == 'p' || body[start] == 'P') && body[start + 1] == '=') {
-                    // Parse P=1x2,3x4
-                    p_commands++;
-                    size_t pos = start + 2;
-                    int pixels_this_line = 0;
-                    
-                    while (pos < end) {
-                        int x = 0, y = 0;
-                        bool hasX = false, hasY = false;
-                        
-                        // Parse x
-                        while (pos < end && isdigit(body[pos])) {
-                            x = x * 10 + (body[pos] - '0');
-                            pos++;
-                            hasX = true;
-                        }
-                        
-                        if (pos < end && (body[pos] == 'x' || body[pos] == 'X')) {
-                            pos++;
-                            // Parse y
-                            while (pos < end && isdigit(body[pos])) {
-                                y = y * 10 + (body[pos] - '0');
-                                pos++;
-                                hasY = true;
-                            }
-                        }
-                        
-                        if (hasX && hasY) {
-                            pixels.push_back({x, y});
-                            pixels_this_line++;
-                        }
-                        
-                        if (pos < end && body[pos] == ',') pos++;
-                        while (pos < end && isspace(body[pos])) pos++;
-                    }
-                    
-                    if (lines_processed <= 3) {
-                        cout << "[DEBUG]       📌 P command: '" << string(body + start, end - start) << "' → " << pixels_this_line << " pixels" << endl;
-                    }
-                }
-                else if (end - start > 3 && (body[start] == 'p' || body[start] == 'P') && 
-                         (body[start + 1] == 'l' || body[start + 1] == 'L') && body[start + 2] == '=') {
-                    // Parse PL=1x1-10x1
-                    pl_commands++;
-                    size_t pos = start + 3;
-                    int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
-                    int* current = &x1;
-                    
-                    while (pos < end) {
-                        if (isdigit(body[pos])) {
-                            *current = *current * 10 + (body[pos] - '0');
-                        } else if (body[pos] == 'x' || body[pos] == 'X') {
-                            if (current == &x1) current = &y1;
-                            else if (current == &x2) current = &y2;
-                        } else if (body[pos] == '-') {
-                            current = &x2;
-                        }
-                        pos++;
-                    }
-                    
-                    int pixels_before = pixels.size();
-                    
-                    // Generate line
-                    if (y1 == y2) {
-                        int minX = min(x1, x2);
-                        int maxX = max(x1, x2);
-                        for (int x = minX; x <= maxX; x++) {
-                            pixels.push_back({x, y1});
-                        }
-                    } else if (x1 == x2) {
-                        int minY = min(y1, y2);
-                        int maxY = max(y1, y2);
-                        for (int y = minY; y <= maxY; y++) {
-                            pixels.push_back({x1, y});
-                        }
-                    }
-                    
-                    int pixels_added = pixels.size() - pixels_before;
-                    
-                    if (pl_commands <= 3) {
-                        cout << "[DEBUG]       📌 PL command: '" << string(body + start, end - start) << "' → " << pixels_added << " pixels" << endl;
-                    }
-                }
+    // 2️⃣ Parse the bodies on a small pool, each into its own command list
+    vector<Out> perFrame(slices.size());
+    vector<Palette> perFramePalette(slices.size());
+    atomic<size_t> next{0};
+    exception_ptr failure;
+    mutex failureMutex;
+    
+    auto worker = [&]() {
+        try {
+            for (size_t i = next++; i < slices.size(); i = next++) {
+                const FrameSlice& fs = slices[i];
+                Trace::Span span("F-block", "parse");
+                span.arg("start", fs.start);
+                span.arg("end", fs.end);
+                auto collector = makeCollector(perFrame[i], data + len, perFramePalette[i]);
+                FrameScanner scanner;
+                scanner.enterFrame(fs.start, fs.end);
+                collector.start = fs.start;
+                collector.end = fs.end;
+                scanner.scan(data + fs.bodyOffset, fs.bodyLen, collector);
             }
-            
-            lineStart = i + 1;
+        } catch (...) {
+            lock_guard<mutex> lock(failureMutex);
+            if (!failure) failure = current_exception();
+            next = slices.size();   // tell everyone else to stop
+        }
+    };
+    
+    unsigned workers = static_cast<unsigned>(min<size_t>(threads, slices.size()));
+    vector<thread> pool;
+    for (unsigned t = 1; t < workers; t++) {
+        pool.emplace_back([&] {
+            Trace::nameThread("parse");
+            worker();
+        });
+    }
+    worker();   // the calling thread pulls its weight too
+    for (auto& t : pool) t.join();
+    if (failure) rethrow_exception(failure);
+    
+    // 3️⃣ Merge in frame order -> same command list (and palette order) as the serial parse
+    for (size_t i = 0; i < slices.size(); i++) {
+        remapColors(perFrame[i], palette.merge(perFramePalette[i]));
+    }
+    mergeParts(commands, perFrame);
+    
+    HMICX_DEBUG("[DEBUG] 📊 Total commands: " << commandCount(commands) << '\n');
+    HMICX_SUMMARY("parse", "bytes=" << len << " frame_blocks=" << slices.size() << " commands=" << commandCount(commands)
+                  << " threads=" << workers);
+}
+
+void Parser::parse(unsigned threads) {
+    HMICX_DEBUG("[DEBUG] 🚀 Starting parse()...\n");
+    parseHeader();
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    if (threads > 1) parseFramesParallel(commands, threads);
+    else parseFrames(commands);
+    HMICX_DEBUG("[DEBUG] ✅ Parsing complete!\n");
+}
+
+void Parser::parseSpans(unsigned threads) {
+    HMICX_DEBUG("[DEBUG] 🚀 Starting parseSpans()...\n");
+    parseHeader();
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    if (threads > 1) parseFramesParallel(spanCommands, threads);
+    else parseFrames(spanCommands);
+    HMICX_DEBUG("[DEBUG] ✅ Parsing complete!\n");
+}
+
+void Parser::parseArena(unsigned threads) {
+    HMICX_DEBUG("[DEBUG] 🚀 Starting parseArena()...\n");
+    parseHeader();
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    if (threads > 1) parseFramesParallel(arena, threads);
+    else parseFrames(arena);
+    HMICX_DEBUG("[DEBUG] ✅ Parsing complete!\n");
+}
+
+// 🌊 STREAMING PARSER 🌊
+
+struct StreamParser::State {
+    Palette palette;
+    CommandCollector<Command, CommandCallback> collector;
+    FrameScanner scanner;
+    string pending;        // unconsumed tail of the input
+    size_t scanPos = 0;    // where the scanner resumes inside pending
+    size_t headerPos = 0;  // where the info{} search resumes inside pending
+    
+    explicit State(CommandCallback cb) : collector(std::move(cb), nullptr, palette) {}
+};
+
+StreamParser::StreamParser(CommandCallback onCommand) : st(make_unique<State>(std::move(onCommand))) {}
+
+StreamParser::~StreamParser() = default;
+
+const Palette& StreamParser::getPalette() const {
+    return st->palette;
+}
+
+void StreamParser::feed(const char* chunk, size_t len) {
+    if (finished) throw runtime_error("StreamParser: feed() after finish()");
+    st->pending.append(chunk, len);
+    bytesFed += len;
+    process(false);
+}
+
+void StreamParser::finish() {
+    if (finished) return;
+    process(true);
+    finished = true;
+    HMICX_SUMMARY("parse", "bytes=" << bytesFed << " frame_blocks=" << st->collector.frames
+                  << " commands=" << st->collector.emitted << " streaming=1");
+}
+
+void StreamParser::process(bool final) {
+    State& s = *st;
+    const char* buf = s.pending.data();
+    size_t len = s.pending.size();
+    
+    // 📋 Header first - it normally sits right at the top
+    if (!headerDone) {
+        size_t bodyStart = 0, bodyEnd = 0;
+        InfoMatch m = findInfoBlock(buf, len, s.headerPos, final, bodyStart, bodyEnd);
+        if (m == InfoMatch::Found) {
+            parseHeaderBody(buf + bodyStart, bodyEnd - bodyStart, header);
+            headerDone = true;
+        } else if (m == InfoMatch::NotFound) {
+            headerDone = true;   // there is none, stop looking
         }
     }
     
-    cout << "[DEBUG]     📊 Pixel parsing summary: " << lines_processed << " lines, " << p_commands << " P commands, " << pl_commands << " PL commands → " << pixels.size() << " total pixels" << endl;
+    // 🎬 Frames - hand out every color block that is complete by now
+    s.collector.bufEnd = buf + len;
+    s.scanPos += s.scanner.scan(buf + s.scanPos, len - s.scanPos, s.collector, final);
     
-    return pixels;
+    // Drop everything both searches are done with
+    size_t drop = headerDone ? s.scanPos : min(s.scanPos, s.headerPos);
+    if (drop > 0) {
+        s.pending.erase(0, drop);
+        s.scanPos -= drop;
+        s.headerPos = headerDone ? 0 : s.headerPos - drop;
+    }
 }
 
 map<string, string> Parser::getHeader() const {
     return header;
 }
 
+const CommandArena& Parser::getArena() const {
+    return arena;
+}
+
+const vector<SpanCommand>& Parser::getSpanCommands() const {
+    return spanCommands;
+}
+
 vector<Command> Parser::getCommands() const {
     return commands;
 }
\ No newline at end of file
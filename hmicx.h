@@ -1,9 +1,14 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 #include <cstddef>
+#include <cstdint>
 #include <cctype>
 
 namespace HMICX {
@@ -17,33 +22,233 @@ namespace HMICX {
         int start, end;
         std::vector<Pixel> pixels;
         std::string color;
+        uint32_t colorIndex = 0;   // into the parser's Palette
+    };
+
+    // Packed 8-bit color, straight (non-premultiplied) alpha
+    struct RGBA {
+        uint8_t r, g, b, a;
+    };
+
+    // "rgba(r,g,b,a)" / "rgb(r,g,b)" / "#rrggbb" in any case -> RGBA.
+    // Anything unrecognised comes out opaque white
+    RGBA parseColor(std::string_view text);
+
+    // 🎨 PALETTE - every distinct color text in the file, decoded exactly once.
+    // Commands carry an index into it instead of re-parsing their color string
+    class Palette {
+    public:
+        Palette() = default;
+        Palette(Palette&&) = default;
+        Palette& operator=(Palette&&) = default;
+        // names/lookup point into our own blocks, a copy would dangle
+        Palette(const Palette&) = delete;
+        Palette& operator=(const Palette&) = delete;
+
+        // Index for this color text, decoding it the first time it shows up
+        uint32_t intern(std::string_view text);
+        // Add everything from other (already decoded, no re-parsing).
+        // Returns other's index -> our index
+        std::vector<uint32_t> merge(const Palette& other);
+
+        size_t size() const { return entries.size(); }
+        const RGBA& operator[](uint32_t i) const { return entries[i]; }
+        const std::vector<RGBA>& colors() const { return entries; }
+        std::string_view name(uint32_t i) const { return names[i]; }
+
+    private:
+        std::vector<RGBA> entries;
+        std::vector<std::string_view> names;             // point into blocks
+        std::vector<std::unique_ptr<char[]>> blocks;     // name text, never moves once written
+        size_t blockUsed = 0, blockSize = 0;
+        std::unordered_map<std::string_view, uint32_t> lookup;
+
+        std::string_view store(std::string_view text);
+        uint32_t add(std::string_view text, RGBA color);
+    };
+
+    // A horizontal (row) or vertical (column) stretch of `length` pixels starting at x,y
+    struct Run {
+        int x, y, length;
+    };
+
+    // 📏 SPAN FORM OF A COMMAND - PL= lines stay runs instead of being exploded into
+    // one Pixel each (a 449px line is one 12-byte Run instead of 3.5 KB of Pixels).
+    // Draws exactly the same pixels as the Command from the same color block
+    struct SpanCommand {
+        int start, end;
+        std::vector<Pixel> points;   // P= pixels (and 1px PL= lines)
+        std::vector<Run> rows;       // horizontal PL= lines, x = leftmost
+        std::vector<Run> columns;    // vertical PL= lines, y = topmost
+        std::string color;
+        uint32_t colorIndex = 0;     // into the parser's Palette
+
+        size_t pixelCount() const {
+            size_t n = points.size();
+            for (const Run& r : rows) n += static_cast<size_t>(r.length);
+            for (const Run& r : columns) n += static_cast<size_t>(r.length);
+            return n;
+        }
+    };
+
+    // One command inside a CommandArena: where its slices of the shared pools sit
+    struct ArenaCommand {
+        int start, end;
+        uint32_t pointsBegin, pointsCount;
+        uint32_t rowsBegin, rowsCount;
+        uint32_t columnsBegin, columnsCount;
+        uint32_t colorIndex;   // into the parser's Palette
+    };
+
+    // 🧱 ARENA FORM - every command's points and runs live in a handful of shared
+    // pools, commands only hold offsets and a palette index. No allocation per color block, teardown
+    // is a few frees instead of thousands, and the renderer walks contiguous memory.
+    // Same spans as SpanCommand, in the same order
+    struct CommandArena {
+        std::vector<ArenaCommand> commands;
+        std::vector<Pixel> points;
+        std::vector<Run> rows;
+        std::vector<Run> columns;
+
+        const Pixel* pointsOf(const ArenaCommand& c) const { return points.data() + c.pointsBegin; }
+        const Run* rowsOf(const ArenaCommand& c) const { return rows.data() + c.rowsBegin; }
+        const Run* columnsOf(const ArenaCommand& c) const { return columns.data() + c.columnsBegin; }
+
+        size_t pixelCount(const ArenaCommand& c) const {
+            size_t n = c.pointsCount;
+            for (uint32_t i = 0; i < c.rowsCount; i++) n += static_cast<size_t>(rows[c.rowsBegin + i].length);
+            for (uint32_t i = 0; i < c.columnsCount; i++) n += static_cast<size_t>(columns[c.columnsBegin + i].length);
+            return n;
+        }
+    };
+
+    // 🗺️ READ-ONLY MEMORY MAPPING OF A WHOLE FILE (RAII, move-only)
+    // Pages come straight from the page cache, no heap copy of the file
+    class MappedFile {
+    private:
+        void* addr = nullptr;
+        size_t length = 0;
+
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& filepath);
+        ~MappedFile();
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return static_cast<const char*>(addr); }
+        size_t size() const { return length; }
+        std::string_view view() const { return {data(), length}; }
     };
 
     // 🎯 MAIN PARSER CLASS - THE STAR OF THE SHOW
     class Parser {
     private:
-        std::string content;
+        std::string content;      // owned copy (only for the ifstream path)
+        MappedFile mapping;       // owned mapping (only for mapFile)
+        std::string_view data;    // what we actually parse - never owns anything
         std::map<std::string, std::string> header;
         std::vector<Command> commands;
+        std::vector<SpanCommand> spanCommands;
+        CommandArena arena;
+        Palette palette;
         
         // Core parsing methods (implementation in .cpp)
         void parseHeader();
-        void parseHeaderBody(const char* body, size_t len);
-        void parseFrames();
-        void parseFrameBody(const char* body, size_t len, int start, int end);
-        std::vector<Pixel> parsePixels(const char* body, size_t len);
+        // Out = std::vector<Command>, std::vector<SpanCommand> or CommandArena
+        template <class Out> void parseFrames(Out& out);
+        template <class Out> void parseFramesParallel(Out& out, unsigned threads);
+
+        struct BorrowTag {};
+        Parser(std::string_view buffer, BorrowTag);
+        explicit Parser(MappedFile&& mapped);
 
     public:
+        // Reads the whole file into an owned string
         Parser(const std::string& filepath);
-        void parse();
+
+        // ⚡ ZERO-COPY FACTORIES ⚡
+        // mapFile: mmap the file and parse straight over the mapped pages
+        // fromBuffer: parse a caller-owned buffer, which must outlive the Parser
+        static Parser mapFile(const std::string& filepath);
+        static Parser fromBuffer(std::string_view buffer);
+
+        // data points into our own members, so no copies/moves allowed
+        Parser(const Parser&) = delete;
+        Parser& operator=(const Parser&) = delete;
+
+        // threads: 1 = serial, 0 = one per hardware thread, N = up to N workers.
+        // Frame blocks are parsed independently and merged in file order,
+        // so the commands come out identical to the serial parse
+        void parse(unsigned threads = 1);
+        // Same, but fills getSpanCommands() instead of getCommands() - far less memory
+        // for line-heavy files and what the renderer wants anyway
+        void parseSpans(unsigned threads = 1);
+        // Same spans again, but pooled into getArena() - no per-command allocations
+        void parseArena(unsigned threads = 1);
         std::map<std::string, std::string> getHeader() const;
         std::vector<Command> getCommands() const;
+        const std::vector<SpanCommand>& getSpanCommands() const;
+        const CommandArena& getArena() const;
+        // Distinct colors of every command parsed so far, in order of first use
+        const Palette& getPalette() const { return palette; }
+    };
+
+    // 🌊 STREAMING PARSER 🌊
+    // Push the text in chunks of any size (network, pipe, decompressor...) and get every
+    // Command handed to the callback as soon as its color block closes - nothing is kept
+    // around except the unconsumed tail of the input. Commands arrive in file order and
+    // match what Parser::getCommands() would return for the same text.
+    //   StreamParser sp([&](Command&& c) { ... });
+    //   while (...) sp.feed(buf, n);
+    //   sp.finish();
+    class StreamParser {
+    public:
+        using CommandCallback = std::function<void(Command&&)>;
+
+        explicit StreamParser(CommandCallback onCommand);
+        ~StreamParser();
+        StreamParser(const StreamParser&) = delete;
+        StreamParser& operator=(const StreamParser&) = delete;
+
+        void feed(const char* chunk, size_t len);
+        void feed(std::string_view chunk) { feed(chunk.data(), chunk.size()); }
+        // End of input: flushes whatever was waiting for more bytes. No feed() afterwards
+        void finish();
+
+        // The info{} block is usually complete after the first chunk or two
+        bool hasHeader() const { return !header.empty(); }
+        const std::map<std::string, std::string>& getHeader() const { return header; }
+        // Grows as commands arrive, indices handed out earlier stay valid
+        const Palette& getPalette() const;
+
+    private:
+        struct State;
+        std::unique_ptr<State> st;
+        std::map<std::string, std::string> header;
+        bool headerDone = false;
+        bool finished = false;
+        size_t bytesFed = 0;
+
+        void process(bool final);
     };
 
     // ⚡ INLINE HELPER FUNCTIONS - ZERO-COPY OPTIMIZATION GO BRRRR ⚡
     // These are inline so they get embedded at call sites for MAXIMUM SPEED 🏎️
     // Defined in header = no duplicate symbol errors + compiler can optimize better
     
+    // Locale-free ASCII classification (same answers as isspace/isdigit in the "C" locale,
+    // but a couple of compares instead of a libc call per byte)
+    inline bool fastIsSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    inline bool fastIsDigit(char c) {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
     // Fast case-insensitive prefix check without allocating strings
     inline bool fastStartsWith(const char* str, size_t len, const char* prefix, size_t prefixLen) {
         if (len < prefixLen) return false;
@@ -87,4 +292,222 @@ namespace HMICX {
         return {start, static_cast<size_t>(end - start)};
     }
 
+    // Decode one pixel line ("P=1x2,3x4" or "PL=1x1-10x1") and append its pixels.
+    // Blank lines and unknown prefixes are ignored.
+    // parsePixelLine uses the SIMD/SWAR decoder (SSE2, AVX2 with -mavx2) and falls back
+    // to the scalar one for anything unusual; parsePixelLineScalar is the reference.
+    // readableEnd (optional) is the end of the enclosing buffer: when enough bytes after
+    // the line are readable the vector loads run in place instead of on a padded copy
+    void parsePixelLine(const char* line, size_t len, std::vector<Pixel>& out,
+                        const char* readableEnd = nullptr);
+    void parsePixelLineScalar(const char* line, size_t len, std::vector<Pixel>& out);
+    // Span form: P= pixels go to out.points, PL= lines become one Run
+    void parsePixelLine(const char* line, size_t len, SpanCommand& out,
+                        const char* readableEnd = nullptr);
+
+    // One F-block located by FrameScanner::splitFrames: frame range plus where its body
+    // (between the braces) sits in the scanned buffer
+    struct FrameSlice {
+        int start, end;
+        size_t bodyOffset, bodyLen;
+    };
+
+    // 🔎 SINGLE-PASS FRAME SCANNER 🔎
+    // Walks the text exactly once, tracks brace depth itself and reports events to a handler:
+    //   onFrameBegin(int start, int end)       F1{ / F2-5{ opened
+    //   onColor(const char* color, size_t len) rgba(...)/rgb(...)/#rrggbb followed by {
+    //   onPixelLine(const char* line, size_t len)  one raw (untrimmed) line of a color block
+    //   onColorEnd()                            color block closed
+    //   onFrameEnd()                            frame closed
+    // scan() returns how many bytes it consumed. With final=false it stops in front of any
+    // token that could continue past the end of the buffer, so a caller can append the next
+    // chunk to the unconsumed tail and call scan() again - state carries over between calls.
+    class FrameScanner {
+    public:
+        // Start inside a frame body (for scanning a body that was already cut out)
+        void enterFrame(int start, int end) {
+            state = State::InFrame;
+            frameStart = start;
+            frameEnd = end;
+            frameDepth = 1;
+        }
+
+        bool inFrame() const { return state != State::TopLevel; }
+
+        template <class Handler>
+        size_t scan(const char* s, size_t len, Handler& h, bool final = true);
+
+        // Only find the F-blocks (brace counting, no color/pixel work) so the bodies can be
+        // handed out to workers. Same frame boundaries scan() would see
+        static std::vector<FrameSlice> splitFrames(const char* s, size_t len);
+
+    private:
+        enum class State { TopLevel, InFrame, InColor };
+        State state = State::TopLevel;
+        int frameStart = 0, frameEnd = 0;
+        int frameDepth = 0;   // braces open inside the current frame (1 = directly inside it)
+        int colorDepth = 0;   // braces open inside the current color block
+
+        static constexpr size_t NEED_MORE = static_cast<size_t>(-1);
+
+        enum class HeaderMatch { Skip, NeedMore, Open };
+
+        // Try F<digits>[-<digits>] { at pos. Open: pos is just past the '{'. Skip: pos moved
+        // on to where the hunt continues. NeedMore: pos untouched, the buffer ended mid-header
+        static HeaderMatch matchFrameHeader(const char* s, size_t len, size_t& pos, bool final,
+                                            int& start, int& end) {
+            char c = s[pos];
+            if (c != 'F' && c != 'f') { pos++; return HeaderMatch::Skip; }
+            if (pos + 1 >= len) {
+                if (!final) return HeaderMatch::NeedMore;
+                pos = len;
+                return HeaderMatch::Skip;
+            }
+            if (!std::isdigit(static_cast<unsigned char>(s[pos + 1]))) { pos++; return HeaderMatch::Skip; }
+
+            size_t p = pos + 1;
+            start = fastExtractNumber(s, len, p);
+            end = start;
+            if (p >= len && !final) return HeaderMatch::NeedMore;
+            if (p < len && s[p] == '-') {
+                p++;
+                end = fastExtractNumber(s, len, p);
+                if (p >= len && !final) return HeaderMatch::NeedMore;
+            }
+            while (p < len && std::isspace(static_cast<unsigned char>(s[p]))) p++;
+            if (p >= len) {
+                if (!final) return HeaderMatch::NeedMore;
+                pos = len;
+                return HeaderMatch::Skip;
+            }
+
+            pos = p + 1;
+            return s[p] == '{' ? HeaderMatch::Open : HeaderMatch::Skip;
+        }
+
+        // Length of the color token at pos, 0 if there is none, NEED_MORE if the buffer ends mid-token
+        static size_t matchColor(const char* s, size_t len, size_t pos, bool final) {
+            size_t avail = len - pos;
+            const char* p = s + pos;
+
+            if (p[0] == 'r' || p[0] == 'R') {
+                size_t open;
+                if (fastStartsWith(p, avail, "rgba(", 5)) open = 5;
+                else if (fastStartsWith(p, avail, "rgb(", 4)) open = 4;
+                else {
+                    // "rg" at the very end of a chunk might still become "rgba("
+                    if (!final && avail < 5 && (fastStartsWith("rgba(", 5, p, avail))) return NEED_MORE;
+                    return 0;
+                }
+                for (size_t i = open; i < avail; i++) {
+                    if (p[i] == ')') return i + 1;
+                    if (p[i] == '{' || p[i] == '}') return 0;
+                }
+                return final ? 0 : NEED_MORE;
+            }
+
+            if (p[0] == '#') {
+                if (avail < 7) return final ? 0 : NEED_MORE;
+                for (int i = 1; i <= 6; i++) {
+                    if (!std::isxdigit(static_cast<unsigned char>(p[i]))) return 0;
+                }
+                return 7;
+            }
+
+            return 0;
+        }
+    };
+
+    template <class Handler>
+    size_t FrameScanner::scan(const char* s, size_t len, Handler& h, bool final) {
+        size_t pos = 0;
+
+        while (pos < len) {
+            if (state == State::TopLevel) {
+                // 🎬 Hunt for F<digits>[-<digits>] { - everything else up here is ignored
+                int start = 0, end = 0;
+                HeaderMatch hm = matchFrameHeader(s, len, pos, final, start, end);
+                if (hm == HeaderMatch::NeedMore) return pos;
+                if (hm == HeaderMatch::Open) {
+                    enterFrame(start, end);
+                    h.onFrameBegin(start, end);
+                }
+            }
+            else if (state == State::InFrame) {
+                char c = s[pos];
+                if (c == '}') {
+                    pos++;
+                    if (--frameDepth == 0) {
+                        state = State::TopLevel;
+                        h.onFrameEnd();
+                    }
+                    continue;
+                }
+                if (c == '{') { frameDepth++; pos++; continue; }
+
+                // 🎨 Color token followed by { opens a block
+                size_t tokLen = matchColor(s, len, pos, final);
+                if (tokLen == NEED_MORE) return pos;
+                if (tokLen == 0) { pos++; continue; }
+
+                size_t p = pos + tokLen;
+                while (p < len && std::isspace(static_cast<unsigned char>(s[p]))) p++;
+                if (p >= len) return final ? len : pos;
+
+                if (s[p] != '{') {
+                    pos = p;
+                    continue;
+                }
+
+                h.onColor(s + pos, tokLen);
+                state = State::InColor;
+                colorDepth = 1;
+                pos = p + 1;
+            }
+            else {
+                // 💎 Inside a color block: hand out lines until the block closes
+                size_t lineStart = pos;
+                int depthAtLine = colorDepth;
+                bool closed = false;
+
+                while (pos < len) {
+                    char c = s[pos];
+                    if (c == '\n') {
+                        h.onPixelLine(s + lineStart, pos - lineStart);
+                        pos++;
+                        lineStart = pos;
+                        depthAtLine = colorDepth;
+                    } else if (c == '}') {
+                        if (--colorDepth == 0) {
+                            h.onPixelLine(s + lineStart, pos - lineStart);
+                            pos++;
+                            closed = true;
+                            break;
+                        }
+                        pos++;
+                    } else if (c == '{') {
+                        colorDepth++;
+                        pos++;
+                    } else {
+                        pos++;
+                    }
+                }
+
+                if (!closed) {
+                    // Unfinished line: give it back so the next chunk can complete it
+                    if (!final) {
+                        colorDepth = depthAtLine;
+                        return lineStart;
+                    }
+                    return len;
+                }
+
+                state = State::InFrame;
+                h.onColorEnd();
+            }
+        }
+
+        return len;
+    }
+
 }  // namespace HMICX
\ No newline at end of file